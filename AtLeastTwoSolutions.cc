@@ -1,7 +1,16 @@
+#include "Backbone.h"
+#include "BinaryFormula.h"
+#include "Cardinality.h"
 #include "Dimacs.h"
+#include "DimacsWriter.h"
+#include "Projection.h"
 
+#include <getopt.h>
+#include <limits.h>
+#include <string.h>
 #include <zlib.h>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -9,7 +18,7 @@
 using namespace CNFMITER;
 
 /// add clauses to f, which encode: (a <-> b <-> c)
-void generate_equivalence(Formula &f, Lit a, Lit b, Lit c)
+template <class Sink> void generate_equivalence(Sink &f, Lit a, Lit b, Lit c)
 {
     static std::vector<Lit> C(3, a);
 
@@ -34,78 +43,325 @@ void generate_equivalence(Formula &f, Lit a, Lit b, Lit c)
     f.addClause_(C);
 }
 
-void print_formula(Formula &f, std::string s)
+/// add the clauses of f to out twice, the second time with a full variable offset, and force that
+/// at least one of the variables in differ differs between both copies: a new variable per
+/// such variable is true, iff both copies have the same value, and the final clause, which is
+/// also stored in one_unequal_clause, requires one of them to be false. The clauses are generated
+/// from f on the fly, hence, with a sink that writes them, the duplicated formula is never stored.
+template <class Sink>
+void generate_two_solutions(const Formula &f, const std::vector<Var> &differ, Sink &out, std::vector<Lit> &one_unequal_clause)
 {
-    std::cout << "c AtLeastTwoSolutions, Norbert Manthey, 2021" << std::endl;
-    if (!s.empty()) std::cout << "c " << s << std::endl;
-    std::cout << "c " << std::endl;
-    std::cout << "p cnf " << f.nVars() << " " << f.clauses.size() << std::endl;
-    for (const auto &c : f.clauses) {
-        std::stringstream s;
-        s << c;
-        printf("%s 0\n", s.str().c_str());
+    Var var_offset = f.nVars();
+    out.ensureVars(2 * f.nVars());
+    std::vector<Lit> rewritten_clause;
+
+    /* add formula 2 times, once with a full variable offset */
+    /* duplicate this, to check whether a formuala has more models */
+    for (const auto &clause : f.clauses) {
+        out.addClause_(clause);
+        rewritten_clause.clear();
+        for (Lit l : clause) rewritten_clause.push_back(mkLit(var(l) + var_offset, sign(l)));
+        out.addClause_(rewritten_clause);
+    }
+
+    /* encode variable differences for the selected variables */
+    /* this grows quadratic in the number of models that should be checked for */
+    one_unequal_clause.clear();
+    for (Var v : differ) {
+        Lit a = mkLit(v);
+        Lit A = mkLit(v + var_offset);
+        Lit next_lit = mkLit(out.newVar());
+        /* a <-> (a+offset) <-> next_lit */
+        generate_equivalence(out, a, A, next_lit);
+        one_unequal_clause.push_back(~next_lit);
     }
+
+    /* enforce that at least one assignment has to be different */
+    out.addClause_(one_unequal_clause);
 }
 
-void print_maxsat_formula(Formula &hardclauses, std::vector <Lit> penalty_literals, std::string s, bool pre2021format = true)
+/// add k copies of the clauses of f to out, copy i with a variable offset of i times the variables of
+/// f, and force that the copies, restricted to the variables in differ, are strictly ordered
+/// lexicographically, hence pairwise distinct. Only consecutive copies x and y are compared, with
+/// new variables a_j for "x and y are equal on the first j marked variables":
+///   (-a_j | -x_j | y_j), (-a_j | x_j | y_j | a_j+1), (-a_j | -x_j | -y_j | a_j+1)
+/// where a_0 is true and a_n is false, hence both are left out. The size grows linearly in k, and
+/// permutations of the copies are no models.
+template <class Sink> void generate_distinct_models(const Formula &f, const std::vector<Var> &marked, int k, Sink &out)
 {
-    std::cout << "c AtLeastTwoSolutions, Norbert Manthey, 2021" << std::endl;
-    if (!s.empty()) std::cout << "c " << s << std::endl;
-    std::cout << "c print in pre2021 MaxSat format: " << pre2021format << std::endl;
-    std::cout << "c " << std::endl;
-    if(pre2021format)
-    {
-        size_t top = penalty_literals.size() + 1;
-        std::cout << "p wcnf " << hardclauses.nVars() << " " << hardclauses.clauses.size() + penalty_literals.size() << " " << top << std::endl;
-        /* print the soft unit clauses */
-        for (const auto &unit : penalty_literals) {
-            std::stringstream s;
-            s << 1 << " " << unit;
-            printf("%s 0\n", s.str().c_str());
-        }
-        /* print the hard clauses */
-        for (const auto &c : hardclauses.clauses) {
-            std::stringstream s;
-            s << top << " " << c;
-            printf("%s 0\n", s.str().c_str());
+    Var vars = f.nVars();
+    out.ensureVars(k * vars);
+    std::vector<Lit> C;
+
+    /* add formula k times, each with its own variables */
+    for (const auto &clause : f.clauses) {
+        for (int i = 0; i < k; ++i) {
+            C.clear();
+            for (Lit l : clause) C.push_back(mkLit(var(l) + i * vars, sign(l)));
+            out.addClause_(C);
         }
-    } else {
-        /* print the soft unit clauses */
-        for (const auto &unit : penalty_literals) {
-            std::stringstream s;
-            s << 1 << " " << unit;
-            printf("%s 0\n", s.str().c_str());
+    }
+
+    for (int i = 0; i + 1 < k; ++i) {
+        /* without marked variables, there are no distinct copies */
+        if (marked.empty()) {
+            C.clear();
+            out.addClause_(C);
+            break;
         }
-        /* print the hard clauses */
-        for (const auto &c : hardclauses.clauses) {
-            std::stringstream s;
-            s << "h " << c;
-            printf("%s 0\n", s.str().c_str());
+
+        Lit equal = lit_Undef; /* a_j, undefined for a_0 */
+        for (size_t j = 0; j < marked.size(); ++j) {
+            Lit x = mkLit(marked[j] + i * vars), y = mkLit(marked[j] + (i + 1) * vars);
+            Lit next = j + 1 < marked.size() ? mkLit(out.newVar()) : lit_Undef;
+
+            /* a_j -> x_j <= y_j */
+            C.clear();
+            if (equal != lit_Undef) C.push_back(~equal);
+            C.push_back(~x);
+            C.push_back(y);
+            out.addClause_(C);
+
+            /* a_j & x_j == y_j -> a_j+1 */
+            for (int value = 0; value < 2; ++value) {
+                C.clear();
+                if (equal != lit_Undef) C.push_back(~equal);
+                C.push_back(value ? ~x : x);
+                C.push_back(value ? ~y : y);
+                if (next != lit_Undef) C.push_back(next);
+                out.addClause_(C);
+            }
+            equal = next;
         }
     }
+}
+
+/// Same interface as Formula, but writes each clause right away as a hard clause of a MaxSat
+/// formula: with weight top, or with "h" for the post 2020 format, if top is 0.
+class HardClauseWriter
+{
+    DimacsWriter &out;
+    uint64_t top;
+    Var vars;
+
+    public:
+    HardClauseWriter(DimacsWriter &o, uint64_t top_) : out(o), top(top_), vars(0) {}
+
+    int nVars() const { return vars; }
+    Var newVar() { return vars++; }
+    void ensureVars(int n)
+    {
+        if (vars < n) vars = n;
+    }
+
+    void addClause_(ConstClause c)
+    {
+        if (top > 0)
+            out.weightedClause(top, c);
+        else
+            out.hardClause(c);
+    }
+};
 
+/// add two solutions of f to out, whose hamming distance on the variables in differ is at least
+/// distance, where the variable differ[i] is counted weights[i] times. The literals "differ[i] has
+/// different values" are counted with the given cardinality encoding, and the unit clause o_distance
+/// of its outputs is added last. The outputs o_1 .. o_m are returned, where o_j implies a distance
+/// of at least j, so that they can be used as assumptions for smaller distances instead.
+template <class Sink>
+std::vector<Lit> generate_hamming_distance(const Formula &f,
+                                           const std::vector<Var> &differ,
+                                           const std::vector<uint64_t> &weights,
+                                           int distance,
+                                           CardinalityEncoding encoding,
+                                           Sink &out)
+{
+    std::vector<Lit> unequal, counted, C;
+    generate_two_solutions(f, differ, out, unequal);
+
+    /* a variable that stands for w variables adds w to the distance, more than distance do not matter */
+    for (size_t i = 0; i < unequal.size(); ++i)
+        for (uint64_t w = 0; w < weights[i] && w < (uint64_t)distance; ++w) counted.push_back(unequal[i]);
+    std::vector<Lit> outputs = at_least_outputs(out, counted, distance, encoding);
+
+    /* without enough variables, the distance cannot be reached, and the last clause is empty */
+    if (outputs.size() == (size_t)distance) C.push_back(outputs.back());
+    out.addClause_(C);
+    return outputs;
+}
+
+/// add the formula to out that asks for two solutions, or, with models > 0, for that many
+/// pairwise distinct solutions, or, with distance > 0, for two solutions with at least that
+/// hamming distance. Returns the outputs of the cardinality encoding of the latter.
+template <class Sink>
+std::vector<Lit> generate_formula(const Formula &f,
+                                  const std::vector<Var> &differ,
+                                  const std::vector<uint64_t> &weights,
+                                  int models,
+                                  int distance,
+                                  CardinalityEncoding encoding,
+                                  Sink &out)
+{
+    std::vector<Lit> one_unequal_clause;
+    if (distance > 0) return generate_hamming_distance(f, differ, weights, distance, encoding, out);
+    if (models == 0)
+        generate_two_solutions(f, differ, out, one_unequal_clause);
+    else
+        generate_distinct_models(f, differ, models, out);
+    return std::vector<Lit>();
+}
+
+bool print_formula(const Formula &f,
+                   const std::vector<Var> &differ,
+                   const std::vector<uint64_t> &weights,
+                   int models,
+                   int distance,
+                   CardinalityEncoding encoding,
+                   std::string s,
+                   const std::string &output_file,
+                   int threads)
+{
+    /* count variables and clauses for the header first, which also numbers the cardinality outputs */
+    CountingFormula count;
+    std::vector<Lit> outputs = generate_formula(f, differ, weights, models, distance, encoding, count);
+
+    DimacsWriter out(output_file, threads);
+    if (!out.valid()) return false;
+    out.comment("AtLeastTwoSolutions, Norbert Manthey, 2021");
+    if (!s.empty()) out.comment(s);
+    if (distance > 0) {
+        /* allow to search for the largest distance with assumptions, without the final unit clause */
+        std::stringstream o;
+        o << "distance outputs";
+        for (Lit l : outputs) o << " " << (sign(l) ? "-" : "") << var(l) + 1;
+        out.comment(o.str());
+        if (outputs.size() == (size_t)distance)
+            out.comment("the j-th output implies a distance of at least j, the last clause is the unit of output " +
+                        std::to_string(distance));
+        else
+            out.comment("the j-th output implies a distance of at least j, the last clause is empty, as fewer than " +
+                        std::to_string(distance) + " variables can differ");
+    }
+    out.comment("");
+    out.header(count.nVars(), count.nClauses());
+    StreamingFormula formula(out);
+    generate_formula(f, differ, weights, models, distance, encoding, formula);
+    out.report();
+    return true;
+}
+
+/// the fixed variables are equal in all solutions, and are not compared. Their cost is kept by a
+/// soft unit of a new variable, which is false by a hard unit, so that the optimum is the same as
+/// when comparing them.
+bool print_maxsat_formula(const Formula &f, const std::vector<Var> &differ, const std::vector<uint64_t> &weights, uint64_t fixed, std::string s, const std::string &output_file, int threads, bool pre2021format = true)
+{
+    /* count variables and clauses for the header first, which also collects the penalty literals */
+    CountingFormula count;
+    std::vector<Lit> penalty_literals;
+    generate_two_solutions(f, differ, count, penalty_literals);
+    Lit paid = fixed > 0 ? mkLit(count.newVar()) : lit_Undef;
+
+    DimacsWriter out(output_file, threads);
+    if (!out.valid()) return false;
+    out.comment("AtLeastTwoSolutions, Norbert Manthey, 2021");
+    if (!s.empty()) out.comment(s);
+    out.comment(std::string("print in pre2021 MaxSat format: ") + (pre2021format ? "1" : "0"));
+    out.comment("");
+    if (fixed > 0) out.comment("cost offset " + std::to_string(fixed) + " for fixed variables, by the soft unit " + std::to_string(var(paid) + 1));
+    uint64_t top = 1 + fixed;
+    for (uint64_t w : weights) top += w;
+    if (pre2021format) out.wcnfHeader(count.nVars(), count.nClauses() + penalty_literals.size() + (fixed > 0 ? 2 : 0), top);
+    /* print the soft unit clauses */
+    for (size_t i = 0; i < penalty_literals.size(); ++i) out.softUnit(weights[i], penalty_literals[i]);
+    if (fixed > 0) out.softUnit(fixed, paid);
+    /* print the hard clauses */
+    HardClauseWriter hardclauses(out, pre2021format ? top : 0);
+    std::vector<Lit> one_unequal_clause;
+    generate_two_solutions(f, differ, hardclauses, one_unequal_clause);
+    if (fixed > 0) hardclauses.addClause_(std::vector<Lit>(1, ~paid));
+    out.report();
+    return true;
 }
 
 int main(int argc, char **argv)
 {
     int opt;
     int tseitin = 0;
+    bool detect_inputs = false;
     int maxsat = 0;
+    int models = 0;
+    int distance = 0;
+    CardinalityEncoding encoding = TOTALIZER;
+    bool backbone = true;
+    int threads = default_threads();
+    std::string output_file;
+    std::string cache_dir;
     std::cerr << "c AtLeastTwoSolutions generates a CNF formula " << std::endl
               << "c which is satisfiable if the given input formula has at least 2 models" << std::endl
               << "c" << std::endl
               << "c OPTIONS" << std::endl
+              << "c -j n ... use n threads to parse the input and compress the output" << std::endl
+              << "c -d n ... require two solutions with a hamming distance of at least n" << std::endl
+              << "c -k n ... require n pairwise distinct solutions instead of 2, as a lexicographically ordered chain" << std::endl
+              << "c -o f ... write the formula to file f instead of stdout, compress if f ends with .gz" << std::endl
               << "c -t x ... only force differences among the variables 1 to x" << std::endl
+              << "c -t auto ... only force differences among the variables of the projection lines (c ind, c p show)," << std::endl
+              << "c             or, without such lines, among the variables that are not defined by gates" << std::endl
+              << "c --cache-dir d ... load the input from its binary formula in d, or write it there" << std::endl
+              << "c --cardinality e ... count the distance of -d with encoding e: totalizer (default), counter, sorter" << std::endl
+              << "c --no-backbone ... do not drop fixed variables, and do not merge equivalent ones" << std::endl
               << "c -W   ... encode a MaxSat formula that tries to get two solutions with largest hamming distance" << std::endl
               << "c -w   ... same as -w, but use the pre 2020 MaxSat format" << std::endl
               << std::endl;
 
     // Retrieve the options:
-    while ((opt = getopt(argc, argv, "t:wW")) != -1) { // for each option...
+    enum { OPT_CACHE_DIR = 256, OPT_CARDINALITY, OPT_NO_BACKBONE };
+    static const struct option long_options[] = {{"cache-dir", required_argument, NULL, OPT_CACHE_DIR},
+                                                 {"cardinality", required_argument, NULL, OPT_CARDINALITY},
+                                                 {"no-backbone", no_argument, NULL, OPT_NO_BACKBONE},
+                                                 {NULL, 0, NULL, 0}};
+    while ((opt = getopt_long(argc, argv, "d:j:k:o:t:wW", long_options, NULL)) != -1) { // for each option...
         switch (opt) {
+        case OPT_CACHE_DIR:
+            cache_dir = optarg;
+            std::cerr << "c cache parsed formulas in " << cache_dir << std::endl;
+            break;
+        case OPT_CARDINALITY:
+            encoding = cardinality_encoding(optarg);
+            if (encoding == CARDINALITY_ENCODINGS) {
+                std::cerr << "unknown cardinality encoding " << optarg << ", abort" << std::endl;
+                return 1;
+            }
+            std::cerr << "c use the " << cardinality_encoding_names[encoding] << " cardinality encoding" << std::endl;
+            break;
+        case OPT_NO_BACKBONE:
+            backbone = false;
+            std::cerr << "c encode differences for fixed and equivalent variables, too" << std::endl;
+            break;
+        case 'd':
+            distance = atoi(optarg);
+            std::cerr << "c require a hamming distance of at least " << distance << std::endl;
+            break;
+        case 'j':
+            threads = atoi(optarg);
+            std::cerr << "c use " << threads << " threads" << std::endl;
+            break;
+        case 'k':
+            models = atoi(optarg);
+            std::cerr << "c require " << models << " pairwise distinct solutions" << std::endl;
+            break;
+        case 'o':
+            output_file = optarg;
+            std::cerr << "c write output to " << output_file << std::endl;
+            break;
         case 't':
-            tseitin = atoi(optarg);
-            std::cerr << "c set tseitin variable to " << tseitin << std::endl;
+            if (strcmp(optarg, "auto") == 0) {
+                detect_inputs = true;
+                std::cerr << "c detect the input variables" << std::endl;
+            } else {
+                tseitin = atoi(optarg);
+                std::cerr << "c set tseitin variable to " << tseitin << std::endl;
+            }
             break;
         case 'w':
             maxsat = 1;
@@ -128,74 +384,122 @@ int main(int argc, char **argv)
     }
 
     std::string fn1 = (argv[optind + 0]);
-    gzFile in1 = gzopen(fn1.c_str(), "rb");
 
-    if (!in1) {
-        std::cerr << "failed to open first file, abort!" << std::endl;
-        return 1;
-    }
     if (tseitin < 0) {
         std::cerr << "tseitin variable negative, abort" << std::endl;
         return 1;
     }
 
+    if (models < 0 || (models > 0 && maxsat != 0)) {
+        std::cerr << "number of solutions has to be positive, and cannot be combined with MaxSat, abort" << std::endl;
+        return 1;
+    }
+
+    if (distance < 0 || (distance > 0 && (maxsat != 0 || models > 0))) {
+        std::cerr << "hamming distance has to be positive, and cannot be combined with MaxSat or -k, abort" << std::endl;
+        return 1;
+    }
+
+    if (threads < 1) {
+        std::cerr << "number of threads has to be positive, abort" << std::endl;
+        return 1;
+    }
+
     Formula f1;
 
-    parse_DIMACS(in1, f1);
-    gzclose(in1);
+    if (!read_formula(fn1.c_str(), f1, threads, cache_dir)) {
+        std::cerr << "failed to open first file, abort!" << std::endl;
+        return 1;
+    }
 
     std::cerr << "c Parsed formula with " << f1.nVars() << " vars and " << f1.clauses.size() << std::endl;
 
-    Formula result;
+    /* select the variables to encode differences for */
     int input_vars = f1.nVars();
-    int var_offset = input_vars;
-    int output_vars = 2 * input_vars;
-    while (output_vars > result.nVars()) result.newVar();
-    std::vector<Lit> rewritten_clause;
+    std::vector<char> input;
+    if (detect_inputs) {
+        const char *source = detect_input_variables({&f1}, input_vars, input);
+        std::cerr << "c detected " << std::count(input.begin(), input.end(), 1) << " of " << input_vars
+                  << " variables as inputs, from " << source << std::endl;
+    } else {
+        Var max_v = tseitin == 0 ? input_vars : tseitin;
+        input.assign(max_v, 1);
+        std::cerr << "c encode variable equivalences for first " << max_v << " variables" << std::endl;
+    }
 
-    /* add formula 2 times, once with a full variable offset */
-    /* duplicate this, to check whether a formuala has more models */
-    for (const auto &clause : f1.clauses) {
-        result.addClause_(clause);
-        rewritten_clause.clear();
-        for (int i = 0; i < clause.size(); ++i) {
-            Lit l = clause[i];
-            Var v = var(l);
-            rewritten_clause.push_back(mkLit(v + var_offset, sign(l)));
+    /* marked variables that do not occur in the clauses are free in each copy, and must not share their
+     * numbers with the variables of the other copies, in all modes */
+    if ((int)input.size() > input_vars) f1.ensureVars(input_vars = input.size());
+    if (models > 0) {
+        size_t marked = std::count(input.begin(), input.end(), 1);
+        if ((uint64_t)models * (input_vars + marked) >= (uint64_t)INT_MAX) {
+            std::cerr << "too many variables for " << models << " copies of the formula, abort" << std::endl;
+            return 1;
         }
-        result.addClause_(rewritten_clause);
+        std::cerr << "c chain " << models << " copies of the formula, ordered by " << marked << " variables" << std::endl;
     }
 
-    /* encode variable differences for given number of variables */
-    /* this grows quadratic in the number of models that should be checked for */
-    Var max_v = tseitin == 0 ? input_vars : tseitin;
-    int next_var = output_vars;
-    std::vector<Lit> one_unequal_clause;
-    std::cerr << "c encode variable equivalences for first " << max_v << " variables" << std::endl;
-    for (Var v = 0; v < max_v; ++v) {
-        Lit a = mkLit(v);
-        Lit A = mkLit(v + var_offset);
-        Lit next_lit = mkLit(next_var++);
-        while (var(next_lit) >= result.nVars()) result.newVar();
-        /* a <-> (a+offset) <-> next_lit */
-        generate_equivalence(result, a, A, next_lit);
-        one_unequal_clause.push_back(~next_lit);
+    /* variables that are fixed, or equivalent to another one, cannot differ on their own */
+    std::vector<Var> differ;
+    std::vector<uint64_t> weights; /* per variable in differ, the variables it stands for */
+    uint64_t fixed = 0;            /* selected variables with the same value in all solutions */
+    BackboneLite b;
+    if (backbone) {
+        b = find_backbone_lite(f1, input, 2 * f1.clauses.literals() + 1000000);
+        std::cerr << "c backbone: " << b.units << " units, " << b.failed << " failed literals, " << b.equivalent
+                  << " equivalent variables" << (b.unsatisfiable ? ", the formula is unsatisfiable" : "") << std::endl;
     }
-
-    /* enforce that at least one assignment has to be different */
-    result.addClause_(one_unequal_clause);
+    std::vector<int> position(b.unsatisfiable ? 0 : b.value.size(), -1); /* of a representative in differ */
+    for (Var v = 0; v < (Var)input.size(); ++v) {
+        if (!input[v]) continue;
+        if (v < (Var)position.size()) {
+            if (b.value[v] != l_Undef) {
+                fixed++;
+                continue;
+            }
+            Var r = var(b.representative[v]);
+            if (position[r] >= 0) {
+                weights[position[r]]++;
+                continue;
+            }
+            position[r] = differ.size();
+        }
+        differ.push_back(v);
+        weights.push_back(1);
+    }
+    std::cerr << "c encode differences for " << differ.size() << " of " << std::count(input.begin(), input.end(), 1)
+              << " variables" << std::endl;
+    uint64_t can_differ = 0;
+    for (uint64_t w : weights) can_differ += w;
+    if (distance > 0 && can_differ < (uint64_t)distance)
+        std::cerr << "c only " << can_differ << " variables can differ, less than the distance " << distance
+                  << ", the formula is unsatisfiable" << std::endl;
 
     std::stringstream s;
     if (maxsat == 0) {
-        s << "encode formula to check whether there are more than 1 solution for " << fn1;
+        if (distance > 0)
+            s << "encode formula to check whether there are 2 solutions with hamming distance at least " << distance
+              << " for " << fn1 << " with the " << cardinality_encoding_names[encoding] << " encoding";
+        else if (models > 0)
+            s << "encode formula to check whether there are at least " << models << " solutions for " << fn1;
+        else
+            s << "encode formula to check whether there are more than 1 solution for " << fn1;
         if (tseitin != 0) s << " with tseitin base variable " << tseitin;
+        if (detect_inputs) s << " with detected input variables";
         /* one of the common literal pair should have unequal truth values has to be */
-        print_formula(result, s.str());
+        if (!print_formula(f1, differ, weights, models, distance, encoding, s.str(), output_file, threads)) {
+            std::cerr << "failed to open output file, abort!" << std::endl;
+            return 1;
+        }
     } else {
         s << "encode formula to find two solutions with the highest hamming distance for a given formula, at least 1, for " << fn1;
         if (tseitin != 0) s << " with tseitin base variable " << tseitin;
+        if (detect_inputs) s << " with detected input variables";
         /* there is a cost setting variables to equal truth values, hence, pay cost for each unit */
-        print_maxsat_formula(result, one_unequal_clause, s.str(), maxsat == 1);
+        if (!print_maxsat_formula(f1, differ, weights, fixed, s.str(), output_file, threads, maxsat == 1)) {
+            std::cerr << "failed to open output file, abort!" << std::endl;
+            return 1;
+        }
     }
 
 
@@ -0,0 +1,156 @@
+/**************************************************************************************[Backbone.h]
+A cheap approximation of the backbone and the equivalent literals of a formula: unit propagation,
+failed literal probing, and strongly connected components of the binary implication graph.
+**************************************************************************************************/
+
+#ifndef CNFMITER_Backbone_h
+#define CNFMITER_Backbone_h
+
+#include <algorithm>
+#include <vector>
+
+#include "Solver.h"
+#include "SolverTypes.h"
+
+namespace CNFMITER
+{
+
+struct BackboneLite {
+    std::vector<lbool> value;        // per variable, the value in all models, or l_Undef
+    std::vector<Lit> representative; // per variable, an equivalent literal, the same for all its equivalent literals
+    size_t units = 0;                // variables with a value from unit propagation
+    size_t failed = 0;               // variables with a value from failed literals
+    size_t equivalent = 0;           // variables that are not their own representative
+    bool unsatisfiable = false;      // the formula has no model, nothing else is set then
+};
+
+// Strongly connected components of the implication graph of the binary clauses, after removing
+// the literals with a value, with Tarjan's algorithm. Each component is a set of equivalent
+// literals, whose representative is its smallest literal; then the representative of the
+// negated component is the negation of this literal. Returns false, if a literal is equivalent
+// to its negation.
+static bool equivalent_literals(const Formula &f, const std::vector<lbool> &value, std::vector<Lit> &representative)
+{
+    int vars = value.size();
+    std::vector<uint64_t> start(2 * vars + 1, 0);
+    std::vector<Lit> edges, c;
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<uint64_t> pos(start.begin(), start.end() - 1);
+        for (const auto &clause : f.clauses) {
+            c.clear();
+            bool satisfied = false;
+            for (Lit l : clause) {
+                lbool v = value[var(l)] ^ sign(l);
+                satisfied = satisfied || v == l_True;
+                if (v == l_Undef) c.push_back(l);
+            }
+            if (satisfied || c.size() != 2 || c[0] == c[1] || c[0] == ~c[1]) continue;
+            if (pass == 0) {
+                start[toInt(~c[0]) + 1]++;
+                start[toInt(~c[1]) + 1]++;
+            } else {
+                edges[pos[toInt(~c[0])]++] = c[1];
+                edges[pos[toInt(~c[1])]++] = c[0];
+            }
+        }
+        if (pass == 0) {
+            for (size_t i = 1; i < start.size(); ++i) start[i] += start[i - 1];
+            edges.resize(start.back());
+        }
+    }
+
+    std::vector<int> index(2 * vars, -1), low(2 * vars, 0), component(2 * vars, -1);
+    std::vector<Lit> smallest; // per component
+    std::vector<int> stack;
+    std::vector<std::pair<int, uint64_t> > calls; // literal, next edge
+    int next_index = 0;
+    for (int root = 0; root < 2 * vars; ++root) {
+        if (index[root] >= 0) continue;
+        calls.push_back(std::make_pair(root, start[root]));
+        index[root] = low[root] = next_index++;
+        stack.push_back(root);
+        while (!calls.empty()) {
+            int l = calls.back().first;
+            if (calls.back().second < start[l + 1]) {
+                int m = toInt(edges[calls.back().second++]);
+                if (index[m] < 0) {
+                    calls.push_back(std::make_pair(m, start[m]));
+                    index[m] = low[m] = next_index++;
+                    stack.push_back(m);
+                } else if (component[m] < 0 && index[m] < low[l])
+                    low[l] = index[m];
+                continue;
+            }
+            calls.pop_back();
+            if (!calls.empty() && low[l] < low[calls.back().first]) low[calls.back().first] = low[l];
+            if (low[l] != index[l]) continue;
+
+            // l is the root of a component, which is on the stack from l on
+            Lit min = toLit(l);
+            int m;
+            do {
+                m = stack.back();
+                stack.pop_back();
+                component[m] = smallest.size();
+                if (toLit(m) < min) min = toLit(m);
+            } while (m != l);
+            smallest.push_back(min);
+        }
+    }
+
+    representative.resize(vars);
+    for (Var v = 0; v < vars; ++v) {
+        if (component[toInt(mkLit(v))] == component[toInt(~mkLit(v))]) return false;
+        representative[v] = smallest[component[toInt(mkLit(v))]];
+    }
+    return true;
+}
+
+// Values and equivalences of the variables of f. The variables marked in probe, that occur in
+// binary clauses, are probed as failed literals, until the solver propagated budget literals.
+// Without unit and binary clauses, nothing can be found, and the solver is not set up at all.
+static BackboneLite find_backbone_lite(const Formula &f, const std::vector<char> &probe, uint64_t budget)
+{
+    BackboneLite b;
+    std::vector<char> binary(f.nVars(), 0);
+    bool units = false;
+    for (const auto &c : f.clauses) {
+        units = units || c.size() < 2;
+        if (c.size() == 2) binary[var(c[0])] = binary[var(c[1])] = 1;
+    }
+    if (!units && std::find(binary.begin(), binary.end(), 1) == binary.end()) {
+        b.value.assign(f.nVars(), l_Undef);
+        for (Var v = 0; v < f.nVars(); ++v) b.representative.push_back(mkLit(v));
+        return b;
+    }
+
+    Solver solver;
+    while (solver.nVars() < f.nVars()) solver.newVar();
+    for (const auto &c : f.clauses)
+        if (!solver.addClause(c)) break;
+
+    b.value.assign(f.nVars(), l_Undef);
+    std::vector<Lit> implied;
+    for (Var v = 0; v < f.nVars() && solver.okay(); ++v) b.units += solver.value(v) != l_Undef;
+    for (Var v = 0; v < (Var)probe.size() && v < f.nVars() && solver.okay() && solver.propagations < budget; ++v) {
+        if (!probe[v] || !binary[v] || solver.value(v) != l_Undef) continue;
+        if (!solver.probe(mkLit(v), implied) || !solver.probe(~mkLit(v), implied)) b.failed++;
+    }
+    if (!solver.okay()) {
+        b.unsatisfiable = true;
+        return b;
+    }
+    for (Var v = 0; v < f.nVars(); ++v) b.value[v] = solver.value(v);
+
+    if (!equivalent_literals(f, b.value, b.representative)) {
+        b.unsatisfiable = true;
+        return b;
+    }
+    for (Var v = 0; v < f.nVars(); ++v) b.equivalent += var(b.representative[v]) != v;
+    return b;
+}
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
@@ -0,0 +1,222 @@
+/*********************************************************************************[BinaryFormula.h]
+A binary file format for parsed formulas, which is loaded via mmap without parsing, and a cache of
+such files for DIMACS inputs, which is reused as long as the DIMACS file does not change.
+**************************************************************************************************/
+
+#ifndef CNFMITER_BinaryFormula_h
+#define CNFMITER_BinaryFormula_h
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <zlib.h>
+
+#include "Dimacs.h"
+#include "ParseUtils.h"
+#include "SolverTypes.h"
+
+namespace CNFMITER
+{
+
+//=================================================================================================
+// File format:
+//
+// The header is followed by the clause starts (clauses + 1 values of 64 bit) and the literals (32
+// bit each), both as stored in a ClauseArena, and the variables of the projection lines (32 bit
+// each), in the byte order of the writing machine. Files that were written on a machine with
+// another byte order do not match the version.
+
+static const char binary_formula_magic[8] = {'C', 'N', 'F', 'M', 'B', 'I', 'N', '\n'};
+static const uint32_t binary_formula_version = 2;
+
+struct BinaryFormulaHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vars;
+    uint64_t clauses;
+    uint64_t literals;
+    uint64_t source_size;  // size of the DIMACS file the formula was parsed from, if any
+    int64_t source_mtime;  // modification time of this file in ns
+    uint32_t checksum;     // crc32 of the clause starts, the literals and the projection
+    uint32_t projection;   // number of projection variables
+};
+
+static_assert(sizeof(BinaryFormulaHeader) == 56, "binary formula header must not be padded");
+static_assert(sizeof(Lit) == sizeof(uint32_t), "literals are stored with 32 bit");
+
+// crc32 over a memory region of any size (zlib takes 32 bit lengths)
+static uint32_t binary_crc32(uint32_t crc, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    while (size > 0) {
+        uInt n = size > (1u << 30) ? (1u << 30) : (uInt)size;
+        crc = crc32(crc, p, n);
+        p += n;
+        size -= n;
+    }
+    return crc;
+}
+
+static int64_t modification_time(const struct stat &st)
+{
+#ifdef __APPLE__
+    return (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+// The given file starts like a binary formula.
+static bool is_binary_formula(const MappedFile &file)
+{
+    return file.valid() && file.size() >= sizeof(binary_formula_magic) &&
+           memcmp(file.begin(), binary_formula_magic, sizeof(binary_formula_magic)) == 0;
+}
+
+// Write f to filename. The file is written under a temporary name first, and renamed once it is
+// complete, so that other processes never see a partial file. Returns false on errors.
+static bool save_binary_formula(const char *filename, const Formula &f, const struct stat *source = NULL)
+{
+    static std::atomic<unsigned> counter(0);
+    const ClauseArena &arena = f.clauses;
+
+    BinaryFormulaHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, binary_formula_magic, sizeof(header.magic));
+    header.version = binary_formula_version;
+    header.vars = f.nVars();
+    header.clauses = arena.size();
+    header.literals = arena.literals();
+    header.source_size = source ? source->st_size : 0;
+    header.source_mtime = source ? modification_time(*source) : 0;
+    header.checksum = binary_crc32(crc32(0, Z_NULL, 0), arena.startData(), (arena.size() + 1) * sizeof(uint64_t));
+    header.checksum = binary_crc32(header.checksum, arena.literalData(), arena.literals() * sizeof(Lit));
+    header.projection = f.projection.size();
+    header.checksum = binary_crc32(header.checksum, f.projection.data(), f.projection.size() * sizeof(Var));
+
+    char tmp[PATH_MAX + 64];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d.%u", filename, (int)getpid(), counter++);
+    FILE *out = fopen(tmp, "wb");
+    if (!out) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              fwrite(arena.startData(), sizeof(uint64_t), arena.size() + 1, out) == arena.size() + 1 &&
+              fwrite(arena.literalData(), sizeof(Lit), arena.literals(), out) == arena.literals() &&
+              fwrite(f.projection.data(), sizeof(Var), f.projection.size(), out) == f.projection.size();
+    ok = fclose(out) == 0 && ok;
+    ok = ok && rename(tmp, filename) == 0;
+    if (!ok) unlink(tmp);
+    return ok;
+}
+
+// Load a binary formula from a mapped file into f. With a source, the file has to be written for a
+// DIMACS file with the size and modification time of this source. Returns false, if the file does
+// not match, or is damaged, and leaves f unchanged in this case.
+static bool load_binary_formula(const MappedFile &file, Formula &f, const struct stat *source = NULL)
+{
+    BinaryFormulaHeader header;
+    if (!is_binary_formula(file) || file.size() < sizeof(header)) return false;
+    memcpy(&header, file.begin(), sizeof(header));
+    if (header.version != binary_formula_version) return false;
+    if (source && (header.source_size != (uint64_t)source->st_size || header.source_mtime != modification_time(*source)))
+        return false;
+    // bound each count by the remaining bytes before multiplying it, so that no product can wrap
+    uint64_t remaining = file.size() - sizeof(header);
+    if (header.clauses >= remaining / sizeof(uint64_t)) return false;
+    remaining -= (header.clauses + 1) * sizeof(uint64_t);
+    if (header.literals > remaining / sizeof(Lit)) return false;
+    remaining -= header.literals * sizeof(Lit);
+    if (header.projection > remaining / sizeof(Var) || remaining != (uint64_t)header.projection * sizeof(Var))
+        return false;
+
+    const uint64_t *starts = (const uint64_t *)(file.begin() + sizeof(header));
+    const Lit *literals = (const Lit *)(starts + header.clauses + 1);
+    const Var *projection = (const Var *)(literals + header.literals);
+    uint32_t checksum = binary_crc32(crc32(0, Z_NULL, 0), starts, (header.clauses + 1) * sizeof(uint64_t));
+    checksum = binary_crc32(checksum, literals, header.literals * sizeof(Lit));
+    if (binary_crc32(checksum, projection, header.projection * sizeof(Var)) != header.checksum) return false;
+
+    // the checksum does not protect against files that were written wrong in the first place
+    if (starts[0] != 0 || starts[header.clauses] != header.literals || header.vars > (uint32_t)INT_MAX) return false;
+    for (uint64_t i = 0; i < header.clauses; ++i)
+        if (starts[i] > starts[i + 1]) return false;
+    for (uint64_t i = 0; i < header.literals; ++i)
+        if (toInt(literals[i]) < 0 || (uint32_t)var(literals[i]) >= header.vars) return false;
+    for (uint32_t i = 0; i < header.projection; ++i)
+        if (projection[i] < 0 || (uint32_t)projection[i] >= header.vars) return false;
+
+    f = Formula();
+    f.clauses.assign(literals, starts, header.clauses);
+    f.projection.assign(projection, projection + header.projection);
+    f.ensureVars(header.vars);
+    return true;
+}
+
+//=================================================================================================
+// Cache of binary formulas for DIMACS files:
+
+// Name of the binary formula for the given DIMACS file in cache_dir, based on the name and the
+// full path of this file.
+static std::string binary_cache_file(const std::string &cache_dir, const char *filename)
+{
+    char path[PATH_MAX];
+    const char *full = realpath(filename, path) ? path : filename;
+    const char *base = strrchr(full, '/');
+    base = base ? base + 1 : full;
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%08x.cnfb", (unsigned)binary_crc32(crc32(0, Z_NULL, 0), full, strlen(full)));
+    return cache_dir + "/" + base + suffix;
+}
+
+// Read the formula in filename into f, which is either a binary formula, or a DIMACS file (see
+// parse_DIMACS). With a cache_dir, a DIMACS file is loaded from its binary formula in this
+// directory, if the file did not change since the binary formula was written. Otherwise, the file
+// is parsed, and its binary formula is written. Returns false, if the file cannot be read.
+static bool read_formula(const char *filename, Formula &f, int threads = 1, const std::string &cache_dir = "")
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    struct stat st;
+    bool regular = stat(filename, &st) == 0 && S_ISREG(st.st_mode);
+    {
+        MappedFile file(filename);
+        if (is_binary_formula(file)) {
+            if (!load_binary_formula(file, f)) {
+                fprintf(stderr, "c %s is not a valid binary formula\n", filename);
+                return false;
+            }
+            fprintf(stderr, "c loaded binary formula %s in %.3f s\n", filename,
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            return true;
+        }
+    }
+
+    if (cache_dir.empty() || !regular) return parse_DIMACS(filename, f, threads);
+
+    std::string cached = binary_cache_file(cache_dir, filename);
+    if (load_binary_formula(MappedFile(cached.c_str()), f, &st)) {
+        fprintf(stderr, "c loaded %s from cache %s in %.3f s\n", filename, cached.c_str(),
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        return true;
+    }
+
+    if (!parse_DIMACS(filename, f, threads)) return false;
+    mkdir(cache_dir.c_str(), 0777); // might exist already
+    if (!save_binary_formula(cached.c_str(), f, &st))
+        fprintf(stderr, "c warning: failed to write cache file %s\n", cached.c_str());
+    return true;
+}
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
@@ -0,0 +1,137 @@
+/***********************************************************************************[Cardinality.h]
+CNF encodings of "at least k of the given literals are true": a totalizer, a sequential counter,
+and an odd-even merge sorting network. Only the direction that is needed for lower bounds is
+encoded, i.e. each output implies that enough literals are true.
+**************************************************************************************************/
+
+#ifndef CNFMITER_Cardinality_h
+#define CNFMITER_Cardinality_h
+
+#include <string.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+#include "SolverTypes.h"
+
+namespace CNFMITER
+{
+
+enum CardinalityEncoding { TOTALIZER, SEQUENTIAL_COUNTER, SORTING_NETWORK, CARDINALITY_ENCODINGS };
+
+static const char *cardinality_encoding_names[CARDINALITY_ENCODINGS] = {"totalizer", "counter", "sorter"};
+
+// The encoding with the given name, or CARDINALITY_ENCODINGS for unknown names.
+static CardinalityEncoding cardinality_encoding(const char *name)
+{
+    int e = 0;
+    while (e < CARDINALITY_ENCODINGS && strcmp(name, cardinality_encoding_names[e]) != 0) ++e;
+    return (CardinalityEncoding)e;
+}
+
+template <class Sink> static void add_clause(Sink &out, std::vector<Lit> &c, std::initializer_list<Lit> lits)
+{
+    c.clear();
+    for (Lit l : lits)
+        if (l != lit_Undef) c.push_back(l);
+    out.addClause_(c);
+}
+
+// Outputs of the totalizer of lits[begin, end), at most bound many. The k-th output of a node
+// implies that k of the literals below it are true: for outputs a of the left, and b of the right
+// child, (-r_i+j | a_i | b_j) with 1-based indices, where a_0 and b_0 are true, and literals past
+// the end of a or b are false.
+template <class Sink>
+static std::vector<Lit> totalizer(Sink &out, const std::vector<Lit> &lits, size_t begin, size_t end, size_t bound)
+{
+    if (end - begin == 1) return std::vector<Lit>(1, lits[begin]);
+    size_t middle = begin + (end - begin) / 2;
+    std::vector<Lit> a = totalizer(out, lits, begin, middle, bound), b = totalizer(out, lits, middle, end, bound);
+
+    std::vector<Lit> r, c;
+    size_t outputs = std::min(a.size() + b.size(), bound);
+    for (size_t k = 0; k < outputs; ++k) r.push_back(mkLit(out.newVar()));
+    for (size_t i = 0; i <= a.size(); ++i)
+        for (size_t j = 0; j <= b.size() && i + j < outputs; ++j)
+            add_clause(out, c, {~r[i + j], i < a.size() ? a[i] : lit_Undef, j < b.size() ? b[j] : lit_Undef});
+    return r;
+}
+
+// Sequential counter: s[j] of row i implies that j + 1 of the first i + 1 literals are true, by
+// s_i,j -> s_i-1,j | x_i, and s_i,j -> s_i-1,j | s_i-1,j-1.
+template <class Sink> static std::vector<Lit> sequential_counter(Sink &out, const std::vector<Lit> &lits, size_t bound)
+{
+    std::vector<Lit> previous, s, c;
+    for (size_t i = 0; i < lits.size(); ++i) {
+        s.clear();
+        for (size_t j = 0; j <= i && j < bound; ++j) {
+            Lit above = j < previous.size() ? previous[j] : lit_Undef;
+            if (i == 0) { // the first output is the first literal
+                s.push_back(lits[0]);
+                continue;
+            }
+            s.push_back(mkLit(out.newVar()));
+            add_clause(out, c, {~s[j], above, lits[i]});
+            if (j > 0) add_clause(out, c, {~s[j], above, previous[j - 1]});
+        }
+        previous.swap(s);
+    }
+    return previous;
+}
+
+// Batcher's odd-even merge sort, with the literals in descending order: a comparator replaces
+// the wires a and b by a | b and a & b. The inputs are padded to a power of two with a false
+// literal.
+template <class Sink> static std::vector<Lit> sorting_network(Sink &out, const std::vector<Lit> &lits, size_t bound)
+{
+    std::vector<Lit> wires(lits), c;
+    size_t n = 1;
+    while (n < wires.size()) n *= 2;
+    if (n > wires.size()) {
+        Lit f = mkLit(out.newVar());
+        add_clause(out, c, {~f});
+        wires.resize(n, f);
+    }
+
+    for (size_t p = 1; p < n; p *= 2)
+        for (size_t k = p; k >= 1; k /= 2)
+            for (size_t j = k % p; j + k < n; j += 2 * k)
+                for (size_t i = 0; i < k && i + j + k < n; ++i) {
+                    if ((i + j) / (2 * p) != (i + j + k) / (2 * p)) continue;
+                    Lit a = wires[i + j], b = wires[i + j + k];
+                    Lit max = mkLit(out.newVar()), min = mkLit(out.newVar());
+                    add_clause(out, c, {~max, a, b});
+                    add_clause(out, c, {~min, a});
+                    add_clause(out, c, {~min, b});
+                    wires[i + j] = max;
+                    wires[i + j + k] = min;
+                }
+
+    wires.resize(std::min(bound, lits.size()));
+    return wires;
+}
+
+// Add the clauses of the given encoding to out, and return its outputs o_1 .. o_m, where m is the
+// smaller of bound and the number of literals. Output o_k implies that at least k of the literals
+// are true, hence a unit o_k encodes the constraint, and o_k can be used as assumption as well.
+// With fewer literals than bound, there is no output o_bound, as the constraint cannot be satisfied;
+// callers have to encode this case otherwise, e.g. with the empty clause.
+template <class Sink>
+static std::vector<Lit> at_least_outputs(Sink &out, const std::vector<Lit> &lits, size_t bound, CardinalityEncoding encoding)
+{
+    if (lits.empty() || bound == 0) return std::vector<Lit>();
+    switch (encoding) {
+    case SEQUENTIAL_COUNTER:
+        return sequential_counter(out, lits, bound);
+    case SORTING_NETWORK:
+        return sorting_network(out, lits, bound);
+    default:
+        return totalizer(out, lits, 0, lits.size(), bound);
+    }
+}
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
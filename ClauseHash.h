@@ -0,0 +1,121 @@
+/************************************************************************************[ClauseHash.h]
+Normalization and hashing of clauses, to find equal clauses within and across formulas.
+**************************************************************************************************/
+
+#ifndef CNFMITER_ClauseHash_h
+#define CNFMITER_ClauseHash_h
+
+#include <algorithm>
+#include <vector>
+
+#include "SolverTypes.h"
+#include "Threads.h"
+
+namespace CNFMITER
+{
+
+//=================================================================================================
+// Clause normalization:
+
+// Store the literals of c sorted and without duplicates in out. Returns false, if the clause is a
+// tautology, i.e. contains a literal and its complement.
+static inline bool normalize_clause(ConstClause c, std::vector<Lit> &out)
+{
+    out.assign(c.begin(), c.end());
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    for (size_t i = 1; i < out.size(); ++i)
+        if (out[i] == ~out[i - 1]) return false; // '<' makes p, ~p adjacent
+    return true;
+}
+
+// Hash of a normalized clause.
+static inline uint64_t hash_clause(ConstClause c)
+{
+    uint64_t h = 0xcbf29ce484222325ULL ^ c.size();
+    for (Lit l : c) h = (h ^ (uint64_t)(uint32_t)toInt(l)) * 0x100000001b3ULL;
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return h ^ (h >> 32);
+}
+
+struct ClauseKey {
+    uint64_t hash;
+    size_t index; // of the clause in its formula
+
+    bool operator<(const ClauseKey &o) const { return hash < o.hash || (hash == o.hash && index < o.index); }
+};
+
+// Hash the normalized form of all clauses, with the given number of threads. The keys are sorted, so
+// that equal clauses are adjacent, and clauses with equal hashes appear in their original order.
+static void hash_clauses(const ClauseArena &clauses, std::vector<ClauseKey> &keys, int threads)
+{
+    const size_t chunk = 65536;
+    keys.resize(clauses.size());
+    parallel_for((clauses.size() + chunk - 1) / chunk, threads, [&](int c) {
+        std::vector<Lit> normalized;
+        size_t end = std::min(clauses.size(), (c + 1) * chunk);
+        for (size_t i = c * chunk; i < end; ++i) {
+            normalize_clause(clauses[i], normalized);
+            keys[i].hash = hash_clause(normalized);
+            keys[i].index = i;
+        }
+    });
+    std::sort(keys.begin(), keys.end());
+}
+
+//=================================================================================================
+// Formula normalization:
+
+struct NormalizeStats {
+    size_t tautologies = 0;
+    size_t duplicates = 0;
+    size_t duplicate_literals = 0;
+};
+
+// Sort the literals of all clauses, and remove duplicate literals, tautologies and duplicate
+// clauses. The first occurrence of a clause is kept, the order of the clauses does not change.
+static NormalizeStats normalize_formula(Formula &f, int threads)
+{
+    NormalizeStats stats;
+    std::vector<ClauseKey> keys;
+    hash_clauses(f.clauses, keys, threads);
+
+    // mark later occurrences of equal clauses
+    std::vector<char> drop(f.clauses.size(), 0);
+    std::vector<Lit> a, b;
+    for (size_t i = 0; i < keys.size();) {
+        size_t end = i + 1;
+        while (end < keys.size() && keys[end].hash == keys[i].hash) ++end;
+        for (size_t x = i; end - i > 1 && x < end; ++x) {
+            if (drop[keys[x].index]) continue;
+            normalize_clause(f.clauses[keys[x].index], a);
+            for (size_t y = x + 1; y < end; ++y) {
+                if (drop[keys[y].index]) continue;
+                normalize_clause(f.clauses[keys[y].index], b);
+                if (a == b) drop[keys[y].index] = 1, stats.duplicates++;
+            }
+        }
+        i = end;
+    }
+    std::vector<ClauseKey>().swap(keys);
+
+    ClauseArena result;
+    result.reserve(f.clauses.size(), f.clauses.literals());
+    for (size_t i = 0; i < f.clauses.size(); ++i) {
+        if (drop[i]) continue;
+        if (!normalize_clause(f.clauses[i], a)) {
+            stats.tautologies++;
+            continue;
+        }
+        stats.duplicate_literals += f.clauses[i].size() - a.size();
+        result.push_back(a);
+    }
+    f.clauses.swap(result);
+    return stats;
+}
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
@@ -0,0 +1,96 @@
+/************************************************************************************[Components.h]
+Split formulas into variable-disjoint components.
+**************************************************************************************************/
+
+#ifndef CNFMITER_Components_h
+#define CNFMITER_Components_h
+
+#include <vector>
+
+#include "SolverTypes.h"
+
+namespace CNFMITER
+{
+
+//=================================================================================================
+// Union-find over variables:
+
+class UnionFind
+{
+    std::vector<Var> parent;
+    std::vector<int> size;
+
+    public:
+    explicit UnionFind(int vars) : parent(vars), size(vars, 1)
+    {
+        for (Var v = 0; v < vars; ++v) parent[v] = v;
+    }
+
+    Var find(Var v)
+    {
+        while (parent[v] != v) {
+            parent[v] = parent[parent[v]]; // path halving
+            v = parent[v];
+        }
+        return v;
+    }
+
+    void merge(Var a, Var b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        if (size[a] < size[b]) std::swap(a, b);
+        parent[b] = a;
+        size[a] += size[b];
+    }
+};
+
+//=================================================================================================
+// Components:
+
+// Store for each variable below 'vars' the index of its connected component in component, where
+// two variables are connected if they appear in a common clause of one of the formulas. Components
+// are numbered by their smallest variable. Variables that do not occur get component -1. Returns
+// the number of components.
+static int find_components(const std::vector<const Formula *> &formulas, int vars, std::vector<int> &component)
+{
+    UnionFind uf(vars);
+    std::vector<char> occurs(vars, 0);
+    for (const Formula *f : formulas) {
+        for (const auto &c : f->clauses) {
+            for (Lit l : c) {
+                occurs[var(l)] = 1;
+                uf.merge(var(c[0]), var(l));
+            }
+        }
+    }
+
+    int components = 0;
+    std::vector<int> index(vars, -1); // component index of each root
+    component.assign(vars, -1);
+    for (Var v = 0; v < vars; ++v) {
+        if (!occurs[v]) continue;
+        Var root = uf.find(v);
+        if (index[root] == -1) index[root] = components++;
+        component[v] = index[root];
+    }
+    return components;
+}
+
+// Add each clause of f to parts[part[var(c[0])]], with each variable v renamed to local[v].
+// Clauses without literals are added to the first part.
+static void split_formula(const Formula &f, const std::vector<int> &part, const std::vector<Var> &local, std::vector<Formula> &parts)
+{
+    std::vector<Lit> tmp;
+    for (const auto &c : f.clauses) {
+        tmp.clear();
+        for (Lit l : c) tmp.push_back(mkLit(local[var(l)], sign(l)));
+        parts[c.size() == 0 ? 0 : part[var(c[0])]].addClause_(tmp);
+    }
+}
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
@@ -21,12 +21,16 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef Minisat_Dimacs_h
 #define Minisat_Dimacs_h
 
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
 
+#include <chrono>
 #include <vector>
 
 #include "ParseUtils.h"
 #include "SolverTypes.h"
+#include "Threads.h"
 
 namespace CNFMITER
 {
@@ -34,17 +38,62 @@ namespace CNFMITER
 //=================================================================================================
 // DIMACS Parser:
 
+template <class Solver> static inline void addParsedLit(Solver &S, std::vector<Lit> &lits, int parsed_lit)
+{
+    int var = abs(parsed_lit) - 1;
+    if (var >= S.nVars()) S.ensureVars(var + 1);
+    lits.push_back((parsed_lit > 0) ? mkLit(var) : ~mkLit(var));
+}
+
 template <class B, class Solver> static void readClause(B &in, Solver &S, std::vector<Lit> &lits)
 {
-    int parsed_lit, var;
+    int parsed_lit;
     lits.clear();
     for (;;) {
+        // decode as much of the clause as possible directly from the buffered bytes
+        const unsigned char *start = in.current(), *end = in.limit(), *p = start, *next;
+        while ((next = parseIntWindow(p, end, parsed_lit)) != NULL) {
+            p = next;
+            if (parsed_lit == 0) {
+                in.skip(p - start);
+                return;
+            }
+            addParsedLit(S, lits, parsed_lit);
+        }
+        in.skip(p - start);
+
+        // buffer boundary, end of file, or malformed input
         parsed_lit = parseInt(in);
         if (parsed_lit == 0) break;
-        var = abs(parsed_lit) - 1;
-        while (var >= S.nVars()) S.newVar();
-        lits.push_back((parsed_lit > 0) ? mkLit(var) : ~mkLit(var));
+        addParsedLit(S, lits, parsed_lit);
+    }
+}
+
+// Skip a comment line, from its 'c' on. The variables of projection lines, i.e. "c ind v1 ... 0"
+// and "c p show v1 ... 0" as used for projected model counting, are added to projection. Such a
+// list ends at its 0, or at the end of the line.
+template <class B> static void readComment(B &in, std::vector<Var> &projection)
+{
+    ++in;
+    while (*in == ' ' || *in == '\t') ++in;
+    bool list = false;
+    if (*in == 'i')
+        list = eagerMatch(in, "ind");
+    else if (*in == 'p') {
+        ++in;
+        while (*in == ' ' || *in == '\t') ++in;
+        list = eagerMatch(in, "show");
+    }
+    if (list && (*in == ' ' || *in == '\t')) {
+        for (;;) {
+            while (*in == ' ' || *in == '\t') ++in;
+            if (*in != '-' && (*in < '0' || *in > '9')) break;
+            int parsed_var = parseInt(in);
+            if (parsed_var == 0) break;
+            projection.push_back(abs(parsed_var) - 1);
+        }
     }
+    skipLine(in);
 }
 
 template <class B, class Solver> static void parse_DIMACS_main(B &in, Solver &S)
@@ -61,17 +110,145 @@ template <class B, class Solver> static void parse_DIMACS_main(B &in, Solver &S)
             if (eagerMatch(in, "p cnf")) {
                 vars = parseInt(in);
                 clauses = parseInt(in);
+                if (clauses > 0) S.reserve(clauses);
             } else {
                 printf("PARSE ERROR! Unexpected char: %c\n", *in), exit(3);
             }
-        } else if (*in == 'c' || *in == 'p')
-            skipLine(in);
+        } else if (*in == 'c')
+            readComment(in, S.projection);
         else {
             cnt++;
             readClause(in, S, lits);
             S.addClause_(lits);
         }
     }
+    for (Var v : S.projection)
+        if (v >= S.nVars()) S.ensureVars(v + 1);
+    if (vars != S.nVars()) fprintf(stderr, "c WARNING! DIMACS header mismatch: wrong number of variables.\n");
+    if (cnt != clauses) fprintf(stderr, "c WARNING! DIMACS header mismatch: wrong number of clauses.\n");
+}
+
+//=================================================================================================
+// Parallel DIMACS Parser:
+//
+// The input is split into newline aligned chunks, which are tokenized independently. As clauses
+// may span several lines, and hence chunks, each chunk only produces the stream of parsed integers
+// (with 0 terminating a clause). The streams are concatenated in order afterwards, which results in
+// exactly the same clauses as the sequential parser.
+
+static const size_t parallel_parse_min_size = 4 * buffer_size; // smaller files are parsed sequentially
+
+static const int comment_token = INT_MIN;    // a 'c' line started here
+static const int header_token = INT_MIN + 1; // a 'p cnf' line started here
+
+struct DimacsChunk {
+    std::vector<int> tokens;
+    std::vector<Var> projection; // of the projection lines in the chunk
+    int max_var = -1;
+    bool header = false; // the chunk contains a 'p cnf' line, with the values below
+    int vars = 0;
+    int clauses = 0;
+};
+
+static void tokenize_DIMACS_chunk(const unsigned char *begin, size_t size, DimacsChunk &chunk)
+{
+    MappedBuffer in(begin, size);
+    std::vector<int> &tokens = chunk.tokens;
+    tokens.reserve(size / 4);
+    int parsed_lit;
+    for (;;) {
+        skipWhitespace(in);
+        if (*in == EOF)
+            break;
+        else if (*in == 'p') {
+            tokens.push_back(header_token);
+            if (eagerMatch(in, "p cnf")) {
+                chunk.header = true;
+                chunk.vars = parseInt(in);
+                chunk.clauses = parseInt(in);
+            } else {
+                printf("PARSE ERROR! Unexpected char: %c\n", *in), exit(3);
+            }
+        } else if (*in == 'c') {
+            tokens.push_back(comment_token);
+            readComment(in, chunk.projection);
+        } else {
+            const unsigned char *start = in.current(), *end = in.limit(), *p = start, *next;
+            while ((next = parseIntWindow(p, end, parsed_lit)) != NULL) {
+                p = next;
+                tokens.push_back(parsed_lit);
+                if (abs(parsed_lit) - 1 > chunk.max_var) chunk.max_var = abs(parsed_lit) - 1;
+            }
+            in.skip(p - start);
+            skipWhitespace(in);
+            if (isEof(in) || *in == 'c' || *in == 'p') continue;
+
+            parsed_lit = parseInt(in);
+            tokens.push_back(parsed_lit);
+            if (abs(parsed_lit) - 1 > chunk.max_var) chunk.max_var = abs(parsed_lit) - 1;
+        }
+    }
+}
+
+template <class Solver>
+static void parse_DIMACS_parallel(const unsigned char *data, size_t size, Solver &S, int threads)
+{
+    // split into chunks that start at the beginning of a line
+    std::vector<size_t> bounds(1, 0);
+    for (int t = 1; t < threads; ++t) {
+        size_t b = size / threads * t;
+        if (b < bounds.back()) b = bounds.back();
+        const void *nl = b < size ? memchr(data + b, '\n', size - b) : NULL;
+        bounds.push_back(nl ? (const unsigned char *)nl - data + 1 : size);
+    }
+    bounds.push_back(size);
+
+    std::vector<DimacsChunk> chunks(threads);
+    parallel_for(threads, threads, [&](int i) {
+        tokenize_DIMACS_chunk(data + bounds[i], bounds[i + 1] - bounds[i], chunks[i]);
+    });
+
+    int max_var = -1;
+    size_t tokens = 0;
+    for (const auto &chunk : chunks) {
+        if (chunk.max_var > max_var) max_var = chunk.max_var;
+        tokens += chunk.tokens.size();
+        for (Var v : chunk.projection) {
+            S.projection.push_back(v);
+            if (v > max_var) max_var = v;
+        }
+    }
+    S.ensureVars(max_var + 1);
+    S.reserve(0, tokens); // upper bound for the literals, avoids growing the literal array
+
+    // merge in the original order
+    std::vector<Lit> lits;
+    bool open = false; // inside a clause
+    int vars = 0;
+    int clauses = 0;
+    int cnt = 0;
+    for (auto &chunk : chunks) {
+        if (chunk.header) vars = chunk.vars, clauses = chunk.clauses;
+        for (int parsed_lit : chunk.tokens) {
+            if (parsed_lit == comment_token || parsed_lit == header_token) {
+                if (open)
+                    fprintf(stderr, "PARSE ERROR! Unexpected char: %c\n", parsed_lit == comment_token ? 'c' : 'p'),
+                    exit(3);
+            } else if (parsed_lit == 0) {
+                cnt++;
+                S.addClause_(lits);
+                lits.clear();
+                open = false;
+            } else {
+                int var = abs(parsed_lit) - 1;
+                lits.push_back((parsed_lit > 0) ? mkLit(var) : ~mkLit(var));
+                open = true;
+            }
+        }
+        std::vector<int>().swap(chunk.tokens);
+    }
+    if (open) fprintf(stderr, "PARSE ERROR! Unexpected char: %c\n", EOF), exit(3);
+
     if (vars != S.nVars()) fprintf(stderr, "c WARNING! DIMACS header mismatch: wrong number of variables.\n");
     if (cnt != clauses) fprintf(stderr, "c WARNING! DIMACS header mismatch: wrong number of clauses.\n");
 }
@@ -84,6 +261,46 @@ template <class Solver> static void parse_DIMACS(gzFile input_stream, Solver &S)
     parse_DIMACS_main(in, S);
 }
 
+// Inserts the problem stored in the given file into solver. Plain files are memory-mapped and
+// parsed in place, gzip compressed files (and non-regular files) are read through zlib. Mapped
+// files are parsed with the given number of threads. The parse throughput of the used reader is
+// reported on stderr. Returns false, if the file cannot be read.
+//
+template <class Solver> static bool parse_DIMACS(const char *filename, Solver &S, int threads = 1)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t bytes = 0;
+    const char *reader = "mmap";
+
+    MappedFile file(filename);
+    if (file.valid() && !file.isGzip() && threads > 1 && file.size() >= parallel_parse_min_size) {
+        parse_DIMACS_parallel(file.begin(), file.size(), S, threads);
+        bytes = file.size();
+        reader = "parallel mmap";
+    } else if (file.valid() && !file.isGzip()) {
+        MappedBuffer in(file.begin(), file.size());
+        parse_DIMACS_main(in, S);
+        bytes = in.bytes();
+    } else {
+        gzFile input_stream = gzopen(filename, "rb");
+        if (!input_stream) return false;
+        gzbuffer(input_stream, buffer_size);
+        {
+            StreamBuffer in(input_stream);
+            parse_DIMACS_main(in, S);
+            bytes = in.bytes();
+        }
+        gzclose(input_stream);
+        reader = "zlib";
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double mb = bytes / (1024.0 * 1024.0);
+    fprintf(stderr, "c parsed %.2f MB from %s in %.3f s (%.2f MB/s, %s reader)\n", mb, filename, seconds,
+            seconds > 0 ? mb / seconds : 0.0, reader);
+    return true;
+}
+
 //=================================================================================================
 } // namespace CNFMITER
 
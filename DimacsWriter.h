@@ -0,0 +1,430 @@
+/**********************************************************************************[DimacsWriter.h]
+Buffered writer for CNF and WCNF formulas.
+**************************************************************************************************/
+
+#ifndef CNFMITER_DimacsWriter_h
+#define CNFMITER_DimacsWriter_h
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+#include "SolverTypes.h"
+
+namespace CNFMITER
+{
+
+static const size_t write_buffer_size = 4 * 1048576;
+
+static bool try_write_all(int fd, const void *data, size_t n)
+{
+    size_t done = 0;
+    while (done < n) {
+        ssize_t w = write(fd, (const char *)data + done, n - done);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        done += w;
+    }
+    return true;
+}
+
+static void write_all(int fd, const void *data, size_t n)
+{
+    if (!try_write_all(fd, data, n)) fprintf(stderr, "c ERROR! failed to write output: %s\n", strerror(errno)), exit(1);
+}
+
+//=================================================================================================
+// Compressed output:
+//
+// Filled output buffers are queued, and compressed by background threads. Each buffer becomes a
+// gzip member of its own, so that buffers can be compressed in parallel. A writer thread writes the
+// members in their original order. A sequence of gzip members is a valid gzip file.
+
+class GzipOutput
+{
+    struct Block {
+        char *data;
+        size_t size;
+        std::vector<unsigned char> packed;
+        int state; // 0: waiting, 1: being compressed, 2: compressed
+    };
+
+    int fd;
+    int level;
+    size_t max_blocks; // buffers in flight, the producer waits if there are more
+    std::deque<Block *> queue;
+    std::vector<char *> free_buffers;
+    bool closing;
+    uint64_t compressed;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::thread> compressors;
+    std::thread writer;
+
+    GzipOutput(const GzipOutput &);
+    GzipOutput &operator=(const GzipOutput &);
+
+    static void deflateBlock(Block &b, int level)
+    {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            fprintf(stderr, "c ERROR! failed to initialize compression\n"), exit(1);
+        b.packed.resize(deflateBound(&zs, b.size));
+        zs.next_in = (Bytef *)b.data;
+        zs.avail_in = b.size;
+        zs.next_out = b.packed.data();
+        zs.avail_out = b.packed.size();
+        if (deflate(&zs, Z_FINISH) != Z_STREAM_END) fprintf(stderr, "c ERROR! failed to compress output\n"), exit(1);
+        b.packed.resize(zs.total_out);
+        deflateEnd(&zs);
+    }
+
+    void compress()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            Block *b = NULL;
+            for (Block *q : queue)
+                if (q->state == 0) {
+                    b = q;
+                    break;
+                }
+            if (!b) {
+                if (closing) return;
+                changed.wait(lock);
+                continue;
+            }
+            b->state = 1;
+            lock.unlock();
+            deflateBlock(*b, level);
+            lock.lock();
+            b->state = 2;
+            changed.notify_all();
+        }
+    }
+
+    void write()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            changed.wait(lock, [&]() { return (!queue.empty() && queue.front()->state == 2) || (closing && queue.empty()); });
+            if (queue.empty()) return;
+            Block *b = queue.front();
+            lock.unlock();
+            write_all(fd, b->packed.data(), b->packed.size());
+            lock.lock();
+            compressed += b->packed.size();
+            free_buffers.push_back(b->data);
+            queue.pop_front();
+            delete b;
+            changed.notify_all();
+        }
+    }
+
+    public:
+    GzipOutput(int fd_, int threads, int level_ = Z_DEFAULT_COMPRESSION)
+    : fd(fd_), level(level_), max_blocks(2 * (threads < 1 ? 1 : threads) + 1), closing(false), compressed(0)
+    {
+        for (int t = 0; t < (threads < 1 ? 1 : threads); ++t) compressors.push_back(std::thread(&GzipOutput::compress, this));
+        writer = std::thread(&GzipOutput::write, this);
+    }
+
+    ~GzipOutput()
+    {
+        finish();
+        for (char *b : free_buffers) delete[] b;
+    }
+
+    // Hand over a filled buffer, and receive an empty one of write_buffer_size bytes in return.
+    char *submit(char *data, size_t size)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return queue.size() < max_blocks; });
+        Block *b = new Block;
+        b->data = data;
+        b->size = size;
+        b->state = 0;
+        queue.push_back(b);
+        changed.notify_all();
+        if (free_buffers.empty()) return new char[write_buffer_size];
+        char *r = free_buffers.back();
+        free_buffers.pop_back();
+        return r;
+    }
+
+    // Write all pending blocks, and stop the background threads.
+    void finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (closing) return;
+            closing = true;
+        }
+        changed.notify_all();
+        for (auto &t : compressors) t.join();
+        writer.join();
+    }
+
+    uint64_t bytes() const { return compressed; }
+};
+
+//=================================================================================================
+// DIMACS Writer:
+//
+// Numbers are converted by hand into a large output buffer, which is handed to write(2) once it
+// is full. Clauses are written as the literals, each followed by a space, and then " 0", which
+// matches the output of the previous stream based printing byte by byte.
+
+class DimacsWriter
+{
+    int fd;
+    bool own_fd;     // the output file has been opened by the writer
+    GzipOutput *gz;  // compress the output, if set
+    bool ignore_errors, failed;
+    char *buf;
+    size_t pos;
+    uint64_t written; // bytes handed to the output so far
+    std::chrono::steady_clock::time_point start;
+
+    DimacsWriter(const DimacsWriter &);
+    DimacsWriter &operator=(const DimacsWriter &);
+
+    void writeAll(const char *data, size_t n)
+    {
+        if (gz) {
+            // only full buffers are handed over, hence split large writes
+            for (size_t i = 0; i < n; i += write_buffer_size) {
+                size_t len = n - i < write_buffer_size ? n - i : write_buffer_size;
+                char *block = new char[write_buffer_size];
+                memcpy(block, data + i, len);
+                delete[] gz->submit(block, len);
+            }
+        } else if (!ignore_errors)
+            write_all(fd, data, n);
+        else if (!failed)
+            failed = !try_write_all(fd, data, n);
+        written += n;
+    }
+
+    // Make sure there is space for at least n more bytes.
+    void reserve(size_t n)
+    {
+        if (pos + n > write_buffer_size) flush();
+    }
+
+    void putUnsigned(uint64_t v)
+    {
+        static const char digits[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                     "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                     "8081828384858687888990919293949596979899";
+        char tmp[24];
+        char *p = tmp + sizeof(tmp);
+        while (v >= 100) {
+            unsigned i = (v % 100) * 2;
+            v /= 100;
+            *--p = digits[i + 1];
+            *--p = digits[i];
+        }
+        if (v >= 10) {
+            *--p = digits[v * 2 + 1];
+            *--p = digits[v * 2];
+        } else
+            *--p = '0' + (char)v;
+        size_t n = tmp + sizeof(tmp) - p;
+        memcpy(buf + pos, p, n);
+        pos += n;
+    }
+
+    public:
+    explicit DimacsWriter(int fd_ = 1)
+    : fd(fd_), own_fd(false), gz(NULL), ignore_errors(false), failed(false), buf(new char[write_buffer_size]), pos(0), written(0), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    // Write to the given file, or to stdout for an empty name or "-". Files ending in ".gz" are
+    // compressed, using the given number of threads. Check valid() afterwards.
+    DimacsWriter(const std::string &filename, int threads)
+    : fd(1), own_fd(false), gz(NULL), ignore_errors(false), failed(false), buf(new char[write_buffer_size]), pos(0), written(0), start(std::chrono::steady_clock::now())
+    {
+        if (filename.empty() || filename == "-") return;
+        fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        own_fd = fd >= 0;
+        if (fd >= 0 && filename.size() > 3 && filename.compare(filename.size() - 3, 3, ".gz") == 0)
+            gz = new GzipOutput(fd, threads);
+    }
+
+    ~DimacsWriter()
+    {
+        if (fd >= 0) {
+            flush();
+            delete gz;
+            if (own_fd && close(fd) != 0) fprintf(stderr, "c ERROR! failed to close output: %s\n", strerror(errno)), exit(1);
+        }
+        delete[] buf;
+    }
+
+    bool valid() const { return fd >= 0; }
+
+    // Drop the remaining output after a failed write, instead of exiting, e.g. for a pipe to a
+    // process that might not read all of its input. Only for uncompressed output.
+    void ignoreErrors() { ignore_errors = true; }
+
+    void flush()
+    {
+        if (gz) {
+            if (pos > 0) buf = gz->submit(buf, pos);
+            written += pos;
+        } else
+            writeAll(buf, pos);
+        pos = 0;
+    }
+
+    // Plain text, e.g. comments
+    void put(const char *s, size_t n)
+    {
+        reserve(n);
+        if (n > write_buffer_size) return writeAll(s, n);
+        memcpy(buf + pos, s, n);
+        pos += n;
+    }
+    void put(const std::string &s) { put(s.data(), s.size()); }
+    void put(const char *s) { put(s, strlen(s)); }
+
+    void putInt(int64_t v)
+    {
+        reserve(24);
+        if (v < 0) {
+            buf[pos++] = '-';
+            putUnsigned(-(uint64_t)v);
+        } else
+            putUnsigned(v);
+    }
+
+    void putLit(Lit l)
+    {
+        reserve(16);
+        if (sign(l)) buf[pos++] = '-';
+        putUnsigned(var(l) + 1);
+    }
+
+    // "c <text>" line
+    void comment(const std::string &text)
+    {
+        put("c ", 2);
+        put(text);
+        put("\n", 1);
+    }
+
+    void header(int vars, uint64_t clauses)
+    {
+        put("p cnf ");
+        putInt(vars);
+        put(" ", 1);
+        putInt(clauses);
+        put("\n", 1);
+    }
+
+    void wcnfHeader(int vars, uint64_t clauses, uint64_t top)
+    {
+        put("p wcnf ");
+        putInt(vars);
+        put(" ", 1);
+        putInt(clauses);
+        put(" ", 1);
+        putInt(top);
+        put("\n", 1);
+    }
+
+    void clause(ConstClause c)
+    {
+        for (Lit l : c) {
+            putLit(l);
+            buf[pos++] = ' ';
+        }
+        put(" 0\n", 3);
+    }
+
+    // Clause with a weight, or 'h' for hard clauses in the 2022 WCNF format
+    void weightedClause(uint64_t weight, ConstClause c)
+    {
+        putInt(weight);
+        put(" ", 1);
+        clause(c);
+    }
+    void hardClause(ConstClause c)
+    {
+        put("h ", 2);
+        clause(c);
+    }
+    void softUnit(uint64_t weight, Lit l)
+    {
+        putInt(weight);
+        put(" ", 1);
+        putLit(l);
+        put(" 0\n", 3);
+    }
+
+    uint64_t bytes() const { return written + pos; }
+
+    // Report the output throughput on stderr. Waits until compressed output has been written, hence
+    // nothing must be written afterwards.
+    void report()
+    {
+        flush();
+        if (gz) gz->finish();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double mb = written / (1024.0 * 1024.0);
+        if (gz)
+            fprintf(stderr, "c wrote %.2f MB (%.2f MB compressed) in %.3f s (%.2f MB/s)\n", mb,
+                    gz->bytes() / (1024.0 * 1024.0), seconds, seconds > 0 ? mb / seconds : 0.0);
+        else
+            fprintf(stderr, "c wrote %.2f MB in %.3f s (%.2f MB/s)\n", mb, seconds, seconds > 0 ? mb / seconds : 0.0);
+    }
+};
+
+// Same interface as Formula, but clauses are written right away instead of being stored. The
+// DIMACS header has to be written before, e.g. with the numbers from a CountingFormula.
+class StreamingFormula
+{
+    DimacsWriter &out;
+    Var vars;
+    uint64_t clauses;
+
+    public:
+    explicit StreamingFormula(DimacsWriter &o) : out(o), vars(0), clauses(0) {}
+
+    int nVars() const { return vars; }
+    Var newVar() { return vars++; }
+    void ensureVars(int n)
+    {
+        if (vars < n) vars = n;
+    }
+
+    uint64_t nClauses() const { return clauses; }
+    void addClause_(ConstClause c)
+    {
+        out.clause(c);
+        clauses++;
+    }
+};
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
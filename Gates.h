@@ -0,0 +1,394 @@
+/*****************************************************************************************[Gates.h]
+Recognize variables that are defined as a gate of other variables, e.g. by the Tseitin encoding:
+AND (and OR), XOR of 2 or 3 inputs, ITE, and majority, i.e. the carry of a full adder, and one-sided
+definitions as in the Plaisted-Greenbaum encoding, which are completed to gates.
+**************************************************************************************************/
+
+#ifndef CNFMITER_Gates_h
+#define CNFMITER_Gates_h
+
+#include <algorithm>
+#include <vector>
+
+#include "SolverTypes.h"
+
+namespace CNFMITER
+{
+
+enum GateType { AND_GATE, XOR_GATE, ITE_GATE, MAJ_GATE, ONE_SIDED_GATE, GATE_TYPES };
+
+// The output is a function of the inputs, which is encoded by the given clauses of a formula, and
+// for one-sided definitions by the clauses in completion, which are not part of the formula.
+struct Gate {
+    Var output;
+    GateType type;
+    std::vector<Var> inputs;
+    std::vector<size_t> clauses;
+    ClauseArena completion;
+};
+
+//=================================================================================================
+// Gate recognition:
+//
+// Only clauses that contain the output are looked at, via occurrence lists of the candidate
+// outputs, i.e. of the variables that are not marked as inputs. Patterns of 3 or more clauses are
+// only searched among few clauses per output. A gate is only accepted, if all of its inputs are
+// available, i.e. marked as inputs, or defined by a gate already.
+
+class GateFinder
+{
+    const ClauseArena &clauses;
+    const std::vector<char> &input;   // per variable, not a candidate output
+    std::vector<uint64_t> occ_start;  // clauses with candidate literal l: occ[occ_start[l] .. occ_start[l + 1])
+    std::vector<size_t> occ;
+    std::vector<uint32_t> stamp;      // per literal, to mark sets of literals
+    std::vector<size_t> binary;       // per marked literal, the binary clause that marked it
+    uint32_t current_stamp;
+    const std::vector<char> *defined; // per variable, defined by a gate
+    Var below;                        // variables below are available, too
+
+    bool available(Var v) const { return input[v] || (*defined)[v] || v < below; }
+
+    static const size_t max_local_clauses = 4096;
+
+    struct LocalClause {
+        std::vector<Lit> lits;
+        size_t index;
+        bool operator<(const LocalClause &other) const { return lits < other.lits; }
+    };
+    std::vector<LocalClause> local;                 // see collectLocal
+    std::vector<std::pair<Lit, size_t> > negated;   // (l, i) for each local[i] = (-x | l | m), sorted
+
+    size_t occBegin(Lit l) const { return occ_start[toInt(l)]; }
+    size_t occEnd(Lit l) const { return occ_start[toInt(l) + 1]; }
+
+    // literals of clause i, sorted and without duplicates, or empty for a tautology
+    void literals(size_t i, std::vector<Lit> &out) const
+    {
+        out.assign(clauses[i].begin(), clauses[i].end());
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        for (size_t j = 1; j < out.size(); ++j)
+            if (var(out[j]) == var(out[j - 1])) out.clear();
+    }
+
+    // o = AND(inputs), from the binary clauses (-o | l) and a clause (o | -l1 | ... | -lk)
+    bool findAnd(Lit o, Gate &g)
+    {
+        if (++current_stamp == 0) std::fill(stamp.begin(), stamp.end(), 0), current_stamp = 1;
+        std::vector<Lit> c;
+        for (size_t i = occBegin(~o); i < occEnd(~o); ++i) {
+            literals(occ[i], c);
+            if (c.size() != 2) continue;
+            Lit l = c[0] == ~o ? c[1] : c[0];
+            stamp[toInt(l)] = current_stamp;
+            binary[toInt(l)] = occ[i];
+        }
+        for (size_t i = occBegin(o); i < occEnd(o); ++i) {
+            literals(occ[i], c);
+            if (c.size() < 2) continue;
+            bool matches = true;
+            for (Lit l : c) matches = matches && (l == o || (stamp[toInt(~l)] == current_stamp && available(var(l))));
+            if (!matches) continue;
+            g.type = AND_GATE;
+            g.clauses.assign(1, occ[i]);
+            for (Lit l : c) {
+                if (l == o) continue;
+                g.inputs.push_back(var(l));
+                g.clauses.push_back(binary[toInt(~l)]);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Collect the clauses with 3 or 4 literals that contain x, for the patterns of XOR, ITE and
+    // MAJ gates. Returns false, if there are too many of them.
+    bool collectLocal(Var x)
+    {
+        local.clear();
+        negated.clear();
+        LocalClause c;
+        for (int s = 0; s < 2; ++s) {
+            for (size_t i = occBegin(mkLit(x, s)); i < occEnd(mkLit(x, s)); ++i) {
+                literals(occ[i], c.lits);
+                if (c.lits.size() != 3 && c.lits.size() != 4) continue;
+                if (local.size() == max_local_clauses) return false;
+                c.index = occ[i];
+                local.push_back(c);
+            }
+        }
+        std::sort(local.begin(), local.end());
+        for (size_t i = 0; i < local.size(); ++i)
+            if (local[i].lits.size() == 3 && std::binary_search(local[i].lits.begin(), local[i].lits.end(), mkLit(x, true)))
+                for (Lit l : local[i].lits)
+                    if (var(l) != x) negated.push_back(std::make_pair(l, i));
+        std::sort(negated.begin(), negated.end());
+        return true;
+    }
+
+    // index of the collected clause with exactly the given literals, or -1
+    int64_t findLocal(std::vector<Lit> lits) const
+    {
+        LocalClause key;
+        key.lits = lits;
+        std::sort(key.lits.begin(), key.lits.end());
+        std::vector<LocalClause>::const_iterator it = std::lower_bound(local.begin(), local.end(), key);
+        return it != local.end() && it->lits == key.lits ? (int64_t)it->index : -1;
+    }
+
+    // the literal of a clause (-x | l | m) with 3 literals, that is not l
+    static Lit other(const std::vector<Lit> &c, Lit not_x, Lit l)
+    {
+        return c[0] != not_x && c[0] != l ? c[0] : c[1] != not_x && c[1] != l ? c[1] : c[2];
+    }
+
+    // x = XOR(inputs) or its negation, from all 2^k clauses of size k + 1 over x and the k inputs,
+    // whose number of negative literals has the same parity
+    bool findXor(Var x, Gate &g)
+    {
+        std::vector<Lit> pattern;
+        for (const LocalClause &c : local) {
+            bool inputs = true;
+            unsigned parity = 0;
+            for (Lit l : c.lits) inputs = inputs && (var(l) == x || available(var(l))), parity ^= sign(l);
+            if (!inputs) continue;
+            size_t n = c.lits.size();
+            std::vector<size_t> found;
+            for (unsigned signs = 0; signs < (1u << n); ++signs) {
+                unsigned p = 0;
+                pattern.clear();
+                for (size_t k = 0; k < n; ++k) pattern.push_back(mkLit(var(c.lits[k]), (signs >> k) & 1)), p ^= (signs >> k) & 1;
+                if (p != parity) continue;
+                int64_t i = findLocal(pattern);
+                if (i < 0) break;
+                found.push_back(i);
+            }
+            if (found.size() != (1u << (n - 1))) continue;
+            g.type = XOR_GATE;
+            g.clauses = found;
+            for (Lit l : c.lits)
+                if (var(l) != x) g.inputs.push_back(var(l));
+            return true;
+        }
+        return false;
+    }
+
+    // x = ITE(c, t, e), from (-x | -c | t), (-x | c | e), (x | -c | -t) and (x | c | -e)
+    bool findIte(Var x, Gate &g)
+    {
+        Lit o = mkLit(x);
+        for (size_t i = 0; i < negated.size(); ++i) {
+            const std::vector<Lit> &a = local[negated[i].second].lits;
+            Lit c = ~negated[i].first, t = other(a, ~o, ~c);
+            typedef std::vector<std::pair<Lit, size_t> >::const_iterator It;
+            std::pair<It, It> range = std::equal_range(negated.begin(), negated.end(), std::make_pair(c, (size_t)0), lessLiteral);
+            for (It j = range.first; j != range.second; ++j) {
+                Lit e = other(local[j->second].lits, ~o, c);
+                if (!available(var(c)) || !available(var(t)) || !available(var(e))) continue;
+                int64_t p = findLocal({o, ~c, ~t}), q = findLocal({o, c, ~e});
+                if (p < 0 || q < 0) continue;
+                g.type = ITE_GATE;
+                g.inputs = {var(c), var(t), var(e)};
+                g.clauses = {local[negated[i].second].index, local[j->second].index, (size_t)p, (size_t)q};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // x = MAJ(a, b, c), from (-x | a | b), (-x | a | c), (-x | b | c), and the same clauses with
+    // all literals negated
+    bool findMaj(Var x, Gate &g)
+    {
+        Lit o = mkLit(x);
+        for (size_t i = 0; i < negated.size(); ++i) {
+            Lit a = negated[i].first, b = other(local[negated[i].second].lits, ~o, a);
+            typedef std::vector<std::pair<Lit, size_t> >::const_iterator It;
+            std::pair<It, It> range = std::equal_range(negated.begin(), negated.end(), std::make_pair(a, (size_t)0), lessLiteral);
+            for (It j = range.first; j != range.second; ++j) {
+                Lit c = other(local[j->second].lits, ~o, a);
+                if (var(c) == var(b) || !available(var(a)) || !available(var(b)) || !available(var(c))) continue;
+                int64_t bc = findLocal({~o, b, c}), nab = findLocal({o, ~a, ~b}), nac = findLocal({o, ~a, ~c}),
+                        nbc = findLocal({o, ~b, ~c});
+                if (bc < 0 || nab < 0 || nac < 0 || nbc < 0) continue;
+                g.type = MAJ_GATE;
+                g.inputs = {var(a), var(b), var(c)};
+                g.clauses = {local[negated[i].second].index, local[j->second].index, (size_t)bc, (size_t)nab, (size_t)nac, (size_t)nbc};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool lessLiteral(const std::pair<Lit, size_t> &a, const std::pair<Lit, size_t> &b) { return a.first < b.first; }
+
+    // o -> C_1 & .. & C_k, from all clauses (-o | C_i) with -o, completed by the clauses
+    // (o | -l_1 | .. | -l_k) for each choice of l_i from C_i, unless there are more than
+    // max_completion of them
+    bool findOneSided(Lit o, Gate &g, size_t max_completion)
+    {
+        std::vector<std::vector<Lit> > sides;
+        std::vector<Lit> c;
+        size_t completions = 1;
+        for (size_t i = occBegin(~o); i < occEnd(~o); ++i) {
+            literals(occ[i], c);
+            if (c.empty()) return false; // a tautology
+            c.erase(std::find(c.begin(), c.end(), ~o));
+            for (Lit l : c)
+                if (!available(var(l))) return false;
+            completions *= c.size();
+            if (completions > max_completion) return false;
+            sides.push_back(c);
+            g.clauses.push_back(occ[i]);
+        }
+
+        g.type = ONE_SIDED_GATE;
+        for (const std::vector<Lit> &side : sides)
+            for (Lit l : side) g.inputs.push_back(var(l));
+        std::sort(g.inputs.begin(), g.inputs.end());
+        g.inputs.erase(std::unique(g.inputs.begin(), g.inputs.end()), g.inputs.end());
+
+        // choices that pick the same literals are subsumed, e.g. for the majority (a | b) & (a | c) & (b | c)
+        std::vector<std::vector<Lit> > completion;
+        std::vector<size_t> choice(sides.size(), 0);
+        for (size_t n = 0; n < completions; ++n) {
+            c.assign(1, o);
+            for (size_t i = 0; i < sides.size(); ++i) c.push_back(~sides[i][choice[i]]);
+            std::sort(c.begin(), c.end());
+            c.erase(std::unique(c.begin(), c.end()), c.end());
+            bool tautology = false;
+            for (size_t j = 1; j < c.size(); ++j) tautology = tautology || c[j] == ~c[j - 1];
+            if (!tautology) completion.push_back(c);
+            for (size_t i = 0; i < sides.size() && ++choice[i] == sides[i].size(); ++i) choice[i] = 0;
+        }
+        std::sort(completion.begin(), completion.end(),
+                  [](const std::vector<Lit> &a, const std::vector<Lit> &b) { return a.size() < b.size() || (a.size() == b.size() && a < b); });
+        for (size_t i = 0; i < completion.size(); ++i) {
+            bool subsumed = false;
+            for (size_t j = 0; j < g.completion.size() && !subsumed; ++j)
+                subsumed = std::includes(completion[i].begin(), completion[i].end(), g.completion[j].begin(), g.completion[j].end());
+            if (!subsumed) g.completion.push_back(completion[i]);
+        }
+        return true;
+    }
+
+    public:
+    // input has an entry per variable of the clauses
+    GateFinder(const ClauseArena &c, int vars, const std::vector<char> &input_)
+      : clauses(c), input(input_), stamp(2 * vars, 0), binary(2 * vars, 0), current_stamp(0), defined(NULL), below(0)
+    {
+        occ_start.assign(2 * vars + 1, 0);
+        for (const auto &clause : clauses)
+            for (Lit l : clause)
+                if (!input[var(l)]) occ_start[toInt(l) + 1]++;
+        for (size_t i = 1; i < occ_start.size(); ++i) occ_start[i] += occ_start[i - 1];
+        occ.resize(occ_start.back());
+        std::vector<uint64_t> pos(occ_start.begin(), occ_start.end() - 1);
+        for (size_t i = 0; i < clauses.size(); ++i)
+            for (Lit l : clauses[i])
+                if (!input[var(l)]) occ[pos[toInt(l)]++] = i;
+    }
+
+    // Find a gate with output x, whose inputs are available with the given defined variables, or
+    // are below x, if lower_available is set. Returns false, if none of the patterns matches.
+    bool find(Var x, const std::vector<char> &defined_, Gate &g, bool lower_available = false)
+    {
+        defined = &defined_;
+        below = lower_available ? x : 0;
+        g = Gate();
+        g.output = x;
+        if (findAnd(mkLit(x), g) || findAnd(~mkLit(x), g)) return true;
+        return collectLocal(x) && (findXor(x, g) || findIte(x, g) || findMaj(x, g));
+    }
+
+    // Find a one-sided definition of x, where the clauses with -o for o = x or o = -x define
+    // o -> C_1 & .. & C_k, and all variables of the C_i are available. Then, o occurs positively
+    // in all other clauses, so that setting o to C_1 & .. & C_k keeps the formula satisfied, and
+    // the definition can be completed to o = C_1 & .. & C_k, without changing the models on the
+    // other variables. Setting o may change other gates, hence such an output must not be used
+    // as input of gates that are not one-sided. Of both polarities, the one with less completion
+    // clauses is used.
+    bool findOneSided(Var x, const std::vector<char> &defined_, Gate &g, size_t max_completion = 64)
+    {
+        defined = &defined_;
+        below = 0;
+        if (occBegin(mkLit(x)) == occEnd(~mkLit(x))) return false; // x does not occur
+        Gate other;
+        bool found = false;
+        for (int s = 0; s < 2; ++s) {
+            Gate &h = found ? other : g;
+            h = Gate();
+            h.output = x;
+            if (!findOneSided(mkLit(x, s), h, max_completion)) continue;
+            if (found && other.completion.size() < g.completion.size()) std::swap(g, other);
+            found = true;
+        }
+        return found;
+    }
+
+    // Call f(y) for each candidate output y, that occurs in a clause with x.
+    template <class F> void forEachNeighbor(Var x, F f) const
+    {
+        for (int s = 0; s < 2; ++s)
+            for (size_t i = occBegin(mkLit(x, s)); i < occEnd(mkLit(x, s)); ++i)
+                for (Lit l : clauses[occ[i]])
+                    if (!input[var(l)] && var(l) != x) f(var(l));
+    }
+};
+
+// Whether one of the inputs depends on x via the inputs of the gates in depends, of the variables
+// marked in output. Gives up, and returns true, after visiting max_steps variables.
+static bool gate_inputs_depend_on(Var x, const std::vector<Var> &inputs, const std::vector<std::vector<Var> > &depends,
+                                  const std::vector<char> &output, std::vector<char> &seen, size_t max_steps = 100000)
+{
+    std::vector<Var> stack(inputs), visited;
+    bool found = false;
+    while (!stack.empty() && !found) {
+        Var v = stack.back();
+        stack.pop_back();
+        if (seen[v]) continue;
+        seen[v] = 1;
+        visited.push_back(v);
+        found = v == x || visited.size() > max_steps;
+        if (output[v]) stack.insert(stack.end(), depends[v].begin(), depends[v].end());
+    }
+    for (Var v : visited) seen[v] = 0;
+    return found;
+}
+
+// Clear the variables of f in input, that are defined by a gate of other variables in f, as long
+// as the gates do not depend on each other in a cycle. By induction, each of them is a function of
+// the variables that remain marked. Gates of lower variables are taken first, as in the Tseitin
+// encoding, where auxiliary variables follow the variables they depend on. Then, the other
+// variables can be defined by gates of higher variables, unless an input of the gate depends on
+// the variable. Other functional dependencies, e.g. within an at-most-one constraint, are found as
+// well. Returns the number of defined variables.
+static size_t clear_gate_outputs(const Formula &f, std::vector<char> &input)
+{
+    std::vector<char> none(f.nVars(), 0), defined(f.nVars(), 0), output(f.nVars(), 0), seen(f.nVars(), 0);
+    std::vector<std::vector<Var> > depends(f.nVars());
+    GateFinder finder(f.clauses, f.nVars(), none);
+    size_t outputs = 0;
+    Gate g;
+    for (Var x = 0; x < f.nVars(); ++x)
+        if (finder.find(x, defined, g, true)) output[x] = 1, depends[x] = g.inputs, outputs++;
+
+    std::vector<char> others(f.nVars(), 1); // all variables but the candidate are available
+    for (Var x = 0; x < f.nVars(); ++x) {
+        if (output[x]) continue;
+        others[x] = 0;
+        if (finder.find(x, others, g) && !gate_inputs_depend_on(x, g.inputs, depends, output, seen))
+            output[x] = 1, depends[x] = g.inputs, outputs++;
+        others[x] = 1;
+    }
+
+    for (Var x = 0; x < f.nVars(); ++x)
+        if (output[x]) input[x] = 0;
+    return outputs;
+}
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
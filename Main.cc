@@ -1,61 +1,203 @@
+#include "BinaryFormula.h"
+#include "ClauseHash.h"
+#include "Components.h"
 #include "Dimacs.h"
+#include "DimacsWriter.h"
+#include "Gates.h"
+#include "Projection.h"
+#include "Simulation.h"
+#include "Simplifier.h"
+#include "Solver.h"
 
+#include <getopt.h>
+#include <signal.h>
+#include <string.h>
 #include <zlib.h>
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 
 using namespace CNFMITER;
 
-/// add clauses to f, which encode: (clause <-> enabler_lit)
-void generate_or_equivalence(Formula &f, const std::vector<Lit> &clause, Lit enabler_lit)
+/// append clauses to out, which encode: (clause <-> enabler_lit)
+static void generate_or_equivalence(ClauseArena &out, ConstClause clause, Lit enabler_lit)
 {
-    static std::vector<Lit> tmpClause;
-    tmpClause.clear();
-
     // !enabler_lit -> clause
-    tmpClause = clause;
-    tmpClause.push_back(~enabler_lit);
-    f.addClause_(tmpClause);
+    for (Lit l : clause) out.pushLit(l);
+    out.pushLit(~enabler_lit);
+    out.closeClause();
 
     // clause -> enabler_lit
-    tmpClause.clear();
-    tmpClause.push_back(enabler_lit);
-    tmpClause.push_back(enabler_lit);
     for (Lit l : clause) {
-        tmpClause[1] = ~l;
-        f.addClause_(tmpClause);
+        out.pushLit(enabler_lit);
+        out.pushLit(~l);
+        out.closeClause();
     }
 }
 
-/// add formula (l <-> input), return
-void generate_clause_sat(Formula &formula, const Formula &input, Lit &equivalence_lit)
+/// Encodes (l <-> input) for one half of the miter.
+/// Unit clauses are their own enabler. Binary clauses (a | b) only get (e | !a), (e | !b), and
+/// (!l | a | b) instead of (!e | a | b) and (!l | e), as !e already falsifies the clause. Clauses
+/// are expected to be normalized, i.e. free of duplicates and tautologies (see normalize_formula).
+///
+/// The variables of the encoding are fixed up front: the enabler of the i-th clause that is not a
+/// unit is first_var + i, and l follows the last enabler. Hence, the encoding is split into jobs,
+/// which can run on different threads, and produce a fixed part of the clause sequence each.
+class MiterHalf
 {
-    std::vector<Lit> enabler_lits; // literals that are equal to satisfiability of each clause
+    static const size_t chunk_size = 1 << 16; // clauses per job
 
-    for (const auto &c : input.clauses) {
-        Lit enabler_lit = mkLit(formula.newVar());
-        enabler_lits.push_back(enabler_lit);
+    const Formula &input;
+    Var first_var;
+    std::vector<Var> chunk_vars;  // first enabler variable of each chunk, plus the end
+    uint64_t definitions = 0;     // number of clauses that define the enablers
+    uint64_t binaries = 0;
+
+    size_t chunks() const { return chunk_vars.size() - 1; }
 
-        generate_or_equivalence(formula, c, enabler_lit);
+    void encode_definitions(size_t chunk, ClauseArena &out) const
+    {
+        Var v = chunk_vars[chunk];
+        size_t end = std::min(input.clauses.size(), (chunk + 1) * chunk_size);
+        for (size_t i = chunk * chunk_size; i < end; ++i) {
+            ConstClause c = input.clauses[i];
+            if (c.size() == 1) continue;
+
+            Lit enabler_lit = mkLit(v++);
+            if (c.size() == 2) {
+                // !enabler_lit -> clause is false
+                for (Lit l : c) {
+                    out.pushLit(enabler_lit);
+                    out.pushLit(~l);
+                    out.closeClause();
+                }
+            } else {
+                generate_or_equivalence(out, c, enabler_lit);
+            }
+        }
     }
 
-    equivalence_lit = mkLit(formula.newVar());
+    /// (x <-> (a or b)) is the same as (!x <->(!b and !c)), so all enablers -> l
+    void encode_enablers(ClauseArena &out) const
+    {
+        Var v = first_var;
+        for (const auto &c : input.clauses) out.pushLit(c.size() == 1 ? ~c[0] : ~mkLit(v++));
+        out.pushLit(equivalence());
+        out.closeClause();
+    }
 
-    // (x <-> (a or b)) is the same as (!x <->(!b and !c))
-    for (int i = 0; i < enabler_lits.size(); ++i) enabler_lits[i] = ~enabler_lits[i];
-    generate_or_equivalence(formula, enabler_lits, ~equivalence_lit);
-}
+    /// l -> each clause, via its enabler, or the clause itself for binary clauses
+    void encode_implications(size_t chunk, bool binary, ClauseArena &out) const
+    {
+        Var v = chunk_vars[chunk];
+        size_t end = std::min(input.clauses.size(), (chunk + 1) * chunk_size);
+        for (size_t i = chunk * chunk_size; i < end; ++i) {
+            ConstClause c = input.clauses[i];
+            if (binary) {
+                if (c.size() != 2) continue;
+                out.pushLit(~equivalence());
+                out.pushLit(c[0]);
+                out.pushLit(c[1]);
+                out.closeClause();
+                continue;
+            }
+            if (c.size() == 2) {
+                v++;
+                continue;
+            }
+            out.pushLit(~equivalence());
+            out.pushLit(c.size() == 1 ? c[0] : mkLit(v++));
+            out.closeClause();
+        }
+    }
+
+    public:
+    MiterHalf(const Formula &input, Var first_var, int threads) : input(input), first_var(first_var)
+    {
+        size_t n = (input.clauses.size() + chunk_size - 1) / chunk_size;
+        std::vector<Var> vars(n, 0);
+        std::vector<uint64_t> defs(n, 0), bins(n, 0);
+        parallel_for(n, threads, [&](int chunk) {
+            size_t end = std::min(input.clauses.size(), (chunk + 1) * chunk_size);
+            for (size_t i = chunk * chunk_size; i < end; ++i) {
+                size_t size = input.clauses[i].size();
+                if (size == 1) continue;
+                vars[chunk]++;
+                if (size == 2) bins[chunk]++;
+                defs[chunk] += size == 2 ? 2 : size + 1;
+            }
+        });
+
+        chunk_vars.push_back(first_var);
+        for (size_t chunk = 0; chunk < n; ++chunk) {
+            chunk_vars.push_back(chunk_vars.back() + vars[chunk]);
+            definitions += defs[chunk];
+            binaries += bins[chunk];
+        }
+    }
+
+    /// number of variables used by the encoding, starting at first_var
+    int nVars() const { return chunk_vars.back() + 1 - first_var; }
 
-void generate_formula_miter(Formula &formula, const Formula &input1, const Formula &input2)
+    uint64_t nClauses() const { return definitions + 1 + input.clauses.size(); }
+
+    /// literal that is true iff input is satisfied
+    Lit equivalence() const { return mkLit(chunk_vars.back()); }
+
+    /// the encoding is the concatenation of the output of all jobs, in order
+    size_t jobs() const { return 3 * chunks() + 1; }
+
+    void encode(size_t job, ClauseArena &out) const
+    {
+        if (job < chunks())
+            encode_definitions(job, out);
+        else if (job == chunks())
+            encode_enablers(out);
+        else if (job <= 2 * chunks())
+            encode_implications(job - chunks() - 1, false, out);
+        else
+            encode_implications(job - 2 * chunks() - 1, true, out);
+    }
+};
+
+/// add the miter of (common & input1) and (common & input2) to formula, which can be a Formula, or
+/// any other clause sink. As (C & G1) xor (C & G2) = C & (G1 xor G2), common clauses are added as is.
+/// The jobs of both halves are encoded in rounds on the given number of threads, and each round is
+/// added in order, so that the result does not depend on the number of threads.
+template <class Sink>
+void generate_formula_miter(Sink &formula, const Formula &common, const MiterHalf &half1, const MiterHalf &half2, int threads)
 {
-    Lit e1, e2;
-    generate_clause_sat(formula, input1, e1);
-    std::cerr << "c after 1st equivalence formula, miter has " << formula.nVars() << " variables" << std::endl;
-    generate_clause_sat(formula, input2, e2);
-    std::cerr << "c after 2nd equivalence formula, miter has " << formula.nVars() << " variables" << std::endl;
+    for (const auto &c : common.clauses) formula.addClause_(c);
 
+    std::vector<std::pair<const MiterHalf *, size_t> > jobs;
+    for (const MiterHalf *half : {&half1, &half2}) {
+        for (size_t job = 0; job < half->jobs(); ++job) jobs.push_back(std::make_pair(half, job));
+    }
+
+    size_t round = 4 * (size_t)std::max(threads, 1);
+    std::vector<ClauseArena> buffers(std::min(round, jobs.size()));
+    for (size_t begin = 0; begin < jobs.size(); begin += round) {
+        size_t n = std::min(round, jobs.size() - begin);
+        parallel_for(n, threads, [&](int i) {
+            buffers[i].clear();
+            jobs[begin + i].first->encode(jobs[begin + i].second, buffers[i]);
+        });
+        for (size_t i = 0; i < n; ++i) {
+            const ClauseArena &buffer = buffers[i];
+            for (ConstClause c : buffer) formula.addClause_(c);
+        }
+    }
+
+    Lit e1 = half1.equivalence(), e2 = half2.equivalence();
+    formula.ensureVars(std::max(var(e1), var(e2)) + 1);
     std::vector<Lit> clause;
 
     // !e1 -> e2
@@ -67,35 +209,87 @@ void generate_formula_miter(Formula &formula, const Formula &input1, const Formu
     clause[0] = ~e1;
     clause[1] = ~e2;
     formula.addClause_(clause);
-    std::cerr << "c miter has " << formula.nVars() << " variables and " << formula.clauses.size() << " clauses" << std::endl;
 }
 
-/// add offset to all variables in formula, that are greater than largest_input_variable
-void rewrite_variable_range(Formula &formula, Var largest_input_variable, int offset)
+/// add the clauses of input to formula, each with the additional literal ~selector, unless the
+/// selector is lit_Undef
+template <class Sink> void generate_selected_clauses(Sink &formula, const Formula &input, Lit selector)
 {
-    if (offset == 0) return;
-    if (largest_input_variable <= formula.nVars()) return;
+    std::vector<Lit> tmpClause;
+    for (const auto &c : input.clauses) {
+        tmpClause.assign(c.begin(), c.end());
+        if (selector != lit_Undef) tmpClause.push_back(~selector);
+        formula.addClause_(tmpClause);
+    }
+}
 
-    for (auto &c : formula.clauses) {
-        for (size_t i = 0; i < c.size(); ++i) {
-            if (var(c[i]) > largest_input_variable) {
-                c[i] = mkLit(var(c[i]) + offset, sign(c[i]));
-            }
+/// add clauses to formula, which can only be satisfied, if some clause of input with an index in
+/// [begin, end) is falsified: each clause gets a literal that implies the complement of all its
+/// literals, units just use their complement, and one of these literals has to be true, unless the
+/// selector is false
+template <class Sink> void generate_falsified_clause(Sink &formula, const Formula &input, Lit selector, size_t begin, size_t end)
+{
+    std::vector<Lit> falsifiers;
+    std::vector<Lit> tmpClause(2);
+    for (size_t i = begin; i < end; ++i) {
+        ConstClause c = input.clauses[i];
+        if (c.size() == 1) {
+            falsifiers.push_back(~c[0]);
+            continue;
+        }
+        Lit falsifier = mkLit(formula.newVar());
+        falsifiers.push_back(falsifier);
+        tmpClause[0] = ~falsifier;
+        for (Lit l : c) {
+            tmpClause[1] = ~l;
+            formula.addClause_(tmpClause);
         }
     }
 
-    int oldVars = formula.nVars();
-    while (formula.nVars() < oldVars + offset) formula.newVar();
+    if (selector != lit_Undef) falsifiers.push_back(~selector);
+    formula.addClause_(falsifiers);
 }
 
-std::vector<std::vector<Lit>> get_definition_clauses(Formula &f1, int largest_input_variable)
+/// Clauses that are satisfiable, iff (common & input1) does not imply (common & input2), i.e. all
+/// clauses of input1, and some clause of input2 falsified. As common is satisfied already, it is
+/// enough to falsify a clause of input2. If selector is given, input1 and the falsified clause
+/// are only required under the selector, so that both directions can share one formula.
+/// Only the clauses of input2 with an index in [begin, end) are considered, so that the check can
+/// be split into parts.
+struct ImplicationMiter {
+    const Formula &common, &input1, &input2;
+    bool add_common;
+    Lit selector;
+    size_t begin, end;
+
+    template <class Sink> void operator()(Sink &formula) const
+    {
+        if (add_common) generate_selected_clauses(formula, common, lit_Undef);
+        generate_selected_clauses(formula, input1, selector);
+        generate_falsified_clause(formula, input2, selector, begin, end);
+    }
+};
+
+/// Both implication checks in one formula, where the first new variable is the selector.
+struct BothImplicationMiters {
+    const ImplicationMiter &forward, &backward;
+
+    template <class Sink> void operator()(Sink &formula) const
+    {
+        formula.newVar();
+        forward(formula);
+        backward(formula);
+    }
+};
+
+ClauseArena get_definition_clauses(Formula &f1, const std::vector<char> &input, const std::vector<char> *gate_defined = NULL)
 {
-    std::vector<std::vector<Lit>> l2r;
+    ClauseArena l2r;
 
     for (const auto &c : f1.clauses) {
         bool move = false;
         for (size_t i = 0; i < c.size(); ++i) {
-            if (var(c[i]) >= largest_input_variable) {
+            if (!input[var(c[i])] && !(gate_defined && (*gate_defined)[var(c[i])])) {
                 move = true;
                 break;
             }
@@ -106,135 +300,1085 @@ std::vector<std::vector<Lit>> get_definition_clauses(Formula &f1, int largest_in
     return l2r;
 }
 
-/// make sure variables above largest_input_variables are similarly dependent in both formulas
-/// for miters: assume variable sets being mutually exclusive
-void exchange_definition_clauses(Formula &f1, Formula &f2, int largest_input_variable)
+/// make sure variables that are not marked in input are similarly dependent in both formulas
+/// for miters: assume variable sets being mutually exclusive. Variables that are marked in
+/// gate_defined are defined by shared gates already, their clauses are not exchanged.
+void exchange_definition_clauses(Formula &f1, Formula &f2, const std::vector<char> &input, const std::vector<char> *gate_defined = NULL)
 {
-    std::vector<std::vector<Lit>> l2r, r2l;
+    ClauseArena l2r, r2l;
 
-    // get all clauses in f1 and f2 that have variable beyond largest variable
-    l2r = get_definition_clauses(f1, largest_input_variable);
+    // get all clauses in f1 and f2 that have an auxiliary variable
+    l2r = get_definition_clauses(f1, input, gate_defined);
     std::cerr << "c extracted " << l2r.size() << " clauses from f1" << std::endl;
-    r2l = get_definition_clauses(f2, largest_input_variable);
+    r2l = get_definition_clauses(f2, input, gate_defined);
     std::cerr << "c extracted " << r2l.size() << " clauses from f2" << std::endl;
 
     // add the clauses mutually to each formula
+    f2.reserve(f2.clauses.size() + l2r.size(), f2.clauses.literals() + l2r.literals());
     for (const auto &c : l2r) f2.addClause_(c);
+    f1.reserve(f1.clauses.size() + r2l.size(), f1.clauses.literals() + r2l.literals());
     for (const auto &c : r2l) f1.addClause_(c);
 }
 
-void print_formula(Formula &f, std::string s)
+static const char *gate_type_names[GATE_TYPES] = {"and", "xor", "ite", "maj", "one-sided"};
+
+/// Store in gates the gates that define the variables of f that are not marked in input, at most
+/// one per variable, in the order they are found. Each gate only depends on input variables, and
+/// on outputs of earlier gates, hence each defined variable is a function of the input variables.
+/// When a variable is defined, the candidates it occurs with are tried again, each at most
+/// max_attempts times. input has an entry per variable of f. One-sided definitions are only
+/// searched once no other gate can be found, as other gates must not depend on them.
+void find_gates(const Formula &f, const std::vector<char> &input, std::vector<Gate> &gates, int max_attempts = 64)
 {
-    std::cout << "c CNFmiter, Norbert Manthey, 2020" << std::endl;
-    if (!s.empty()) std::cout << "c " << s << std::endl;
-    std::cout << "c " << std::endl;
-    std::cout << "p cnf " << f.nVars() << " " << f.clauses.size() << std::endl;
-    for (const auto &c : f.clauses) {
-        std::stringstream s;
-        s << c;
-        printf("%s 0\n", s.str().c_str());
+    GateFinder finder(f.clauses, f.nVars(), input);
+    std::vector<char> defined(f.nVars(), 0), queued(f.nVars(), 0);
+    std::vector<int> attempts(f.nVars(), 0);
+    std::vector<Var> queue;
+
+    gates.clear();
+    Gate g;
+    for (int one_sided = 0; one_sided < 2; ++one_sided) {
+        for (Var x = f.nVars() - 1; x >= 0; --x)
+            if (!input[x] && !defined[x]) queue.push_back(x), queued[x] = 1, attempts[x] = 0;
+        while (!queue.empty()) { // lowest variables first, which is the order of most encodings
+            Var x = queue.back();
+            queue.pop_back();
+            queued[x] = 0;
+            if (defined[x] || attempts[x]++ == max_attempts) continue;
+            if (!(one_sided ? finder.findOneSided(x, defined, g) : finder.find(x, defined, g))) continue;
+            defined[x] = 1;
+            gates.push_back(g);
+            finder.forEachNeighbor(x, [&](Var y) {
+                if (!defined[y] && !queued[y]) queue.push_back(y), queued[y] = 1;
+            });
+        }
     }
 }
 
-int main(int argc, char **argv)
+/// gates by their clauses, see gate_key, with the variable of their output
+typedef std::map<std::vector<int>, Var> GateTable;
+
+/// the clauses of g, and of its completion, with renamed variables, sorted, where the literals of
+/// the output are -1 and -2, and each clause ends with -3. Gates with the same key define their
+/// outputs as the same function.
+static std::vector<int> gate_key(const Formula &f, const Gate &g, const std::vector<Var> *map)
 {
-    int opt;
+    std::vector<std::vector<int> > clauses;
+    auto add = [&](ConstClause c) {
+        std::vector<int> k;
+        for (Lit l : c) k.push_back(var(l) == g.output ? -1 - sign(l) : toInt(map ? mkLit((*map)[var(l)], sign(l)) : l));
+        std::sort(k.begin(), k.end());
+        k.erase(std::unique(k.begin(), k.end()), k.end());
+        clauses.push_back(k);
+    };
+    for (size_t c : g.clauses) add(f.clauses[c]);
+    for (const auto &c : g.completion) add(c);
+    std::sort(clauses.begin(), clauses.end());
+    clauses.erase(std::unique(clauses.begin(), clauses.end()), clauses.end());
+
+    std::vector<int> key;
+    for (const std::vector<int> &c : clauses) {
+        key.insert(key.end(), c.begin(), c.end());
+        key.push_back(-3);
+    }
+    return key;
+}
+
+/// move the clauses of acyclic gates, which define variables that are not marked in input as
+/// functions of other variables, from f to definitions, and mark the defined variables in
+/// gate_defined. Both formulas can share such definitions as hard clauses, as long as their
+/// defined variables are distinct. With a map, the variables of all clauses of f are renamed
+/// while they are moved, so that the auxiliary variables of both formulas are distinct, without
+/// another pass over the clauses: unmapped variables, with entry var_Undef, get the variables
+/// from next on. Gates that are equal to a gate in known, e.g. of the other formula, are encoded
+/// only once: with a map, their output is mapped to the known output, and their clauses are
+/// dropped. Returns the number of gates, per type in counts, of which merged were dropped.
+size_t extract_gate_definitions(Formula &f, const std::vector<char> &input, std::vector<Var> *map, Var &next,
+                                GateTable &known, Formula &definitions, std::vector<char> &gate_defined,
+                                size_t counts[GATE_TYPES], size_t &merged)
+{
+    std::vector<Gate> gates;
+    find_gates(f, input, gates);
+
+    // gates are in topological order, hence the inputs of a gate are mapped already
+    std::vector<char> definition(f.clauses.size(), 0); // 1 for a definition, 2 for a dropped one
+    for (const Gate &g : gates) {
+        counts[g.type]++;
+        std::pair<GateTable::iterator, bool> entry = known.insert(std::make_pair(gate_key(f, g, map), var_Undef));
+        if (!entry.second && map) {
+            (*map)[g.output] = entry.first->second;
+            for (size_t c : g.clauses) definition[c] = 2;
+            merged++;
+            continue;
+        }
+        if (map) (*map)[g.output] = next++;
+        Var output = map ? (*map)[g.output] : g.output;
+        if (entry.second) entry.first->second = output;
+        gate_defined[output] = 1;
+        for (size_t c : g.clauses) definition[c] = 1;
+        for (const auto &c : g.completion) {
+            for (Lit l : c) definitions.clauses.pushLit(map ? mkLit((*map)[var(l)], sign(l)) : l);
+            definitions.clauses.closeClause();
+        }
+    }
+    if (map)
+        for (Var &v : *map)
+            if (v == var_Undef) v = next++;
+
+    ClauseArena keep;
+    keep.reserve(f.clauses.size(), f.clauses.literals());
+    for (size_t c = 0; c < definition.size(); ++c) {
+        if (definition[c] == 2) continue;
+        ClauseArena &to = definition[c] ? definitions.clauses : keep;
+        for (Lit l : f.clauses[c]) to.pushLit(map ? mkLit((*map)[var(l)], sign(l)) : l);
+        to.closeClause();
+    }
+    f.clauses.swap(keep);
+    return gates.size();
+}
+
+/// add clauses that are present in both formulas to common, comparing clauses after sorting their
+/// literals and removing duplicate literals, and collect the indices of the other clauses of f1
+/// and f2 in keep1 and keep2. Duplicates of a common clause are not kept either. Returns the
+/// number of common clauses. Sorted hashes of the clauses of f1 and f2 (see hash_clauses) can be
+/// given, if they are known already.
+size_t find_common_clauses(const Formula &f1, const Formula &f2, Formula &common, std::vector<size_t> &keep1,
+                           std::vector<size_t> &keep2, int threads, const std::vector<ClauseKey> *keys1 = NULL,
+                           const std::vector<ClauseKey> *keys2 = NULL)
+{
+    std::vector<ClauseKey> own1, own2;
+    if (!keys1) hash_clauses(f1.clauses, own1, threads), keys1 = &own1;
+    if (!keys2) hash_clauses(f2.clauses, own2, threads), keys2 = &own2;
+    const std::vector<ClauseKey> &k1 = *keys1, &k2 = *keys2;
+
+    std::vector<char> shared1(f1.clauses.size(), 0), shared2(f2.clauses.size(), 0);
+    std::vector<size_t> representatives; // one clause of f1 per common clause
+    std::vector<Lit> a, b;
+    size_t i = 0, j = 0;
+    while (i < k1.size() && j < k2.size()) {
+        if (k1[i].hash < k2[j].hash) {
+            ++i;
+            continue;
+        }
+        if (k2[j].hash < k1[i].hash) {
+            ++j;
+            continue;
+        }
+
+        // all clauses with this hash, compare them literally
+        size_t ie = i, je = j;
+        while (ie < k1.size() && k1[ie].hash == k1[i].hash) ++ie;
+        while (je < k2.size() && k2[je].hash == k2[j].hash) ++je;
+        for (size_t x = i; x < ie; ++x) {
+            if (shared1[k1[x].index]) continue;
+            normalize_clause(f1.clauses[k1[x].index], a);
+            bool found = false;
+            for (size_t y = j; y < je; ++y) {
+                if (shared2[k2[y].index]) continue;
+                normalize_clause(f2.clauses[k2[y].index], b);
+                if (a == b) shared2[k2[y].index] = 1, found = true;
+            }
+            if (!found) continue;
+            representatives.push_back(k1[x].index);
+            shared1[k1[x].index] = 1;
+            for (size_t z = x + 1; z < ie; ++z) {
+                if (shared1[k1[z].index]) continue;
+                normalize_clause(f1.clauses[k1[z].index], b);
+                if (a == b) shared1[k1[z].index] = 1;
+            }
+        }
+        i = ie;
+        j = je;
+    }
+    std::sort(representatives.begin(), representatives.end());
+    for (size_t c : representatives) common.addClause_(f1.clauses[c]);
+
+    keep1.clear();
+    for (size_t c = 0; c < shared1.size(); ++c)
+        if (!shared1[c]) keep1.push_back(c);
+    keep2.clear();
+    for (size_t c = 0; c < shared2.size(); ++c)
+        if (!shared2[c]) keep2.push_back(c);
+    return representatives.size();
+}
+
+/// move clauses that are present in both formulas into common, see find_common_clauses
+size_t share_common_clauses(Formula &f1, Formula &f2, Formula &common, int threads)
+{
+    std::vector<size_t> keep1, keep2;
+    size_t shared = find_common_clauses(f1, f2, common, keep1, keep2, threads);
+    if (shared == 0) return 0;
+    f1.clauses.select(keep1);
+    f2.clauses.select(keep2);
+    return shared;
+}
+
+/// write the miter of f1 and f2 without materializing it: a first pass only counts variables and
+/// clauses for the header, the second pass writes the clauses while generating them
+bool print_miter(const Formula &common, const Formula &f1, const Formula &f2, Var maxV, std::string s,
+                 const std::string &output_file, int threads, bool verbose = true,
+                 const std::vector<std::string> *preamble = NULL)
+{
+    if (verbose) std::cerr << "c Miter base formulas reserved " << maxV << " variables" << std::endl;
+    MiterHalf half1(f1, maxV, threads);
+    if (verbose) std::cerr << "c after 1st equivalence formula, miter has " << maxV + half1.nVars() << " variables" << std::endl;
+    MiterHalf half2(f2, maxV + half1.nVars(), threads);
+    int vars = maxV + half1.nVars() + half2.nVars();
+    uint64_t clauses = common.nClauses() + half1.nClauses() + half2.nClauses() + 2;
+    if (verbose) {
+        std::cerr << "c after 2nd equivalence formula, miter has " << vars << " variables" << std::endl;
+        std::cerr << "c miter has " << vars << " variables and " << clauses << " clauses" << std::endl;
+    }
+
+    DimacsWriter out(output_file, threads);
+    if (!out.valid()) return false;
+    if (preamble)
+        for (const std::string &line : *preamble) out.comment(line);
+    out.comment("CNFmiter, Norbert Manthey, 2020");
+    if (!s.empty()) out.comment(s);
+    out.comment("");
+    out.header(vars, clauses);
+
+    StreamingFormula miter(out);
+    miter.ensureVars(maxV);
+    generate_formula_miter(miter, common, half1, half2, threads);
+    assert(miter.nVars() == vars && miter.nClauses() == clauses);
+    if (verbose) out.report();
+    return true;
+}
+
+/// name of an additional output file next to output_file, e.g. "miter.cnf.gz" and "3" results in
+/// "miter.3.cnf.gz". Other files than CNFs, like "manifest", do not get an extension.
+static std::string output_file_name(std::string output_file, const std::string &name, bool cnf = true)
+{
+    bool gz = output_file.size() > 3 && output_file.compare(output_file.size() - 3, 3, ".gz") == 0;
+    if (gz) output_file.resize(output_file.size() - 3);
+    if (output_file.size() > 4 && output_file.compare(output_file.size() - 4, 4, ".cnf") == 0) output_file.resize(output_file.size() - 4);
+    return output_file + "." + name + (cnf ? (gz ? ".cnf.gz" : ".cnf") : "");
+}
+
+/// write one miter for each set of connected components of common, f1 and f2 into separate files,
+/// plus a manifest that lists them. Components are merged in order until a miter has at least
+/// min_vars input variables. The formulas are equivalent, if all miters are unsatisfiable.
+bool print_component_miters(const Formula &common, const Formula &f1, const Formula &f2, Var maxV, std::string s,
+                            const std::string &output_file, int min_vars, int threads)
+{
+    std::vector<int> component;
+    int components = find_components({&common, &f1, &f2}, maxV, component);
+
+    std::vector<int> component_vars(components, 0);
+    for (Var v = 0; v < maxV; ++v)
+        if (component[v] >= 0) component_vars[component[v]]++;
+
+    // merge consecutive components into parts
+    std::vector<int> component_part(components);
+    int parts = 0, part_vars = 0;
+    for (int k = 0; k < components; ++k) {
+        component_part[k] = parts;
+        part_vars += component_vars[k];
+        if (part_vars >= min_vars) parts++, part_vars = 0;
+    }
+    if (part_vars > 0 || parts == 0) parts++;
+
+    // variables of each part are numbered in their original order
+    std::vector<int> part(maxV, -1), vars(parts, 0);
+    std::vector<Var> local(maxV, var_Undef);
+    for (Var v = 0; v < maxV; ++v) {
+        if (component[v] < 0) continue;
+        part[v] = component_part[component[v]];
+        local[v] = vars[part[v]]++;
+    }
+
+    std::vector<Formula> common_parts(parts), parts1(parts), parts2(parts);
+    for (int p = 0; p < parts; ++p) {
+        common_parts[p].ensureVars(vars[p]);
+        parts1[p].ensureVars(vars[p]);
+        parts2[p].ensureVars(vars[p]);
+    }
+    split_formula(common, part, local, common_parts);
+    split_formula(f1, part, local, parts1);
+    split_formula(f2, part, local, parts2);
+    std::cerr << "c found " << components << " components, write " << parts << " miters" << std::endl;
+
+    std::string manifest_file = output_file_name(output_file, "manifest", false);
+    std::ofstream manifest(manifest_file.c_str());
+    if (!manifest) return false;
+    manifest << "c CNFmiter components of " << s << std::endl
+             << "c the formulas are equivalent, if all miters are unsatisfiable. A satisfiable miter shows a" << std::endl
+             << "c difference only, if all other parts of the formula that is satisfied are satisfiable." << std::endl
+             << "c part file variables common clauses1 clauses2" << std::endl;
+
+    for (int p = 0; p < parts; ++p) {
+        std::stringstream name, comment;
+        name << p + 1;
+        comment << s << ", part " << p + 1 << " of " << parts;
+        std::string file = output_file_name(output_file, name.str());
+        if (!print_miter(common_parts[p], parts1[p], parts2[p], vars[p], comment.str(), file, threads, false)) return false;
+        manifest << p + 1 << " " << file << " " << vars[p] << " " << common_parts[p].nClauses() << " "
+                 << parts1[p].nClauses() << " " << parts2[p].nClauses() << std::endl;
+    }
+    std::cerr << "c wrote manifest " << manifest_file << std::endl;
+    return true;
+}
+
+/// write the formula that the given generator adds to a Sink into output_file, and use a first
+/// pass only counts variables and clauses for the header
+template <class Generator>
+bool print_generated_formula(const Generator &generate, Var maxV, const std::string &s, const std::string &output_file, int threads)
+{
+    CountingFormula count;
+    count.ensureVars(maxV);
+    generate(count);
+
+    DimacsWriter out(output_file, threads);
+    if (!out.valid()) return false;
+    out.comment("CNFmiter, Norbert Manthey, 2020");
+    if (!s.empty()) out.comment(s);
+    out.comment("");
+    out.header(count.nVars(), count.nClauses());
+
+    StreamingFormula formula(out);
+    formula.ensureVars(maxV);
+    generate(formula);
+    assert(formula.nVars() == count.nVars() && formula.nClauses() == count.nClauses());
+    fprintf(stderr, "c %s: %d variables and %llu clauses\n", s.c_str(), count.nVars(), (unsigned long long)count.nClauses());
+    out.report();
+    return true;
+}
+
+/// write the checks whether formula 1 implies formula 2, and the other way around. With two files,
+/// each check is written to its own file next to output_file, both at the same time. Otherwise, a
+/// single formula is written, where the first new variable selects the direction. The formulas are
+/// equivalent, iff all written formulas are unsatisfiable.
+bool print_implication_miters(const Formula &common, const Formula &f1, const Formula &f2, Var maxV, std::string s,
+                              const std::string &output_file, bool two_files, int threads)
+{
+    if (!two_files) {
+        // the selector is true for "formula 1 does not imply formula 2"
+        Lit selector = mkLit(maxV);
+        ImplicationMiter forward = {common, f1, f2, true, selector, 0, f2.clauses.size()};
+        ImplicationMiter backward = {common, f2, f1, false, ~selector, 0, f1.clauses.size()};
+        BothImplicationMiters both = {forward, backward};
+        s += ", implication in both directions, selected by variable ";
+        s += std::to_string(maxV + 1);
+        return print_generated_formula(both, maxV, s, output_file, threads);
+    }
+
+    ImplicationMiter forward = {common, f1, f2, true, lit_Undef, 0, f2.clauses.size()};
+    ImplicationMiter backward = {common, f2, f1, true, lit_Undef, 0, f1.clauses.size()};
+    int threads2 = threads > 1 ? threads / 2 : 1;
+    bool printed2 = false;
+    std::thread print2([&]() {
+        printed2 = print_generated_formula(backward, maxV, s + ", formula 2 does not imply formula 1",
+                                           output_file_name(output_file, "21"), threads2);
+    });
+    bool printed1 = print_generated_formula(forward, maxV, s + ", formula 1 does not imply formula 2",
+                                            output_file_name(output_file, "12"), threads - threads2 > 1 ? threads - threads2 : 1);
+    print2.join();
+    return printed1 && printed2;
+}
+
+/// write the implication checks split into parts: each part checks, whether formula 1 implies a
+/// consecutive range of clauses of formula 2, or the other way around. The clauses of each formula
+/// are split into at most 'parts' ranges with about the same number of clauses, or of literals,
+/// as an estimate of the difficulty. All parts are listed in a manifest. The formulas are
+/// equivalent, iff all parts are unsatisfiable.
+bool print_partitioned_miters(const Formula &common, const Formula &f1, const Formula &f2, Var maxV, std::string s,
+                              const std::string &output_file, int parts, bool by_literals, int threads)
+{
+    struct Part {
+        std::string direction, file;
+        ImplicationMiter miter;
+        uint64_t weight;
+    };
+    std::vector<Part> jobs;
+
+    for (int direction = 0; direction < 2; ++direction) {
+        const Formula &implied = direction == 0 ? f2 : f1;
+        std::string name = direction == 0 ? "12" : "21";
+
+        uint64_t total = 0;
+        for (const auto &c : implied.clauses) total += by_literals ? c.size() : 1;
+
+        // cut, once the weight of the current range reaches its share of the total
+        size_t begin = 0;
+        uint64_t weight = 0, seen = 0;
+        int part = 0;
+        for (size_t i = 0; i < implied.clauses.size(); ++i) {
+            uint64_t w = by_literals ? implied.clauses[i].size() : 1;
+            weight += w;
+            seen += w;
+            if (seen * parts < (uint64_t)(part + 1) * total && i + 1 != implied.clauses.size()) continue;
+
+            std::stringstream number;
+            number << name << "." << ++part;
+            Part p = {name, output_file_name(output_file, number.str()),
+                      {common, direction == 0 ? f1 : f2, implied, true, lit_Undef, begin, i + 1}, weight};
+            jobs.push_back(p);
+            begin = i + 1;
+            weight = 0;
+        }
+    }
+    std::cerr << "c write " << jobs.size() << " implication checks" << std::endl;
+
+    std::string manifest_file = output_file_name(output_file, "manifest", false);
+    std::ofstream manifest(manifest_file.c_str());
+    if (!manifest) return false;
+    manifest << "c CNFmiter implication checks of " << s << std::endl
+             << "c the formulas are equivalent, iff all checks are unsatisfiable" << std::endl
+             << "c direction file first_clause clauses " << (by_literals ? "literals" : "weight") << std::endl;
+    for (const Part &p : jobs)
+        manifest << p.direction << " " << p.file << " " << p.miter.begin + 1 << " " << p.miter.end - p.miter.begin
+                 << " " << p.weight << std::endl;
+
+    // each part is small, hence write parts in parallel instead of each part with many threads
+    std::vector<char> printed(jobs.size(), 0);
+    parallel_for(jobs.size(), threads, [&](int i) {
+        const Part &p = jobs[i];
+        std::stringstream comment;
+        comment << s << ", formula " << p.direction[0] << " does not imply clauses " << p.miter.begin + 1 << " to "
+                << p.miter.end << " of formula " << p.direction[1];
+        printed[i] = print_generated_formula(p.miter, maxV, comment.str(), p.file, 1);
+    });
+    std::cerr << "c wrote manifest " << manifest_file << std::endl;
+    for (char ok : printed)
+        if (!ok) return false;
+    return true;
+}
+
+/// Find a clause of f2 that is not implied by (common & f1), by solving f1 under the assumption that
+/// the clause is false. Queries are spread over the threads, each with its own copy of the solver,
+/// so that later queries of a thread reuse the clauses learnt before. Returns the smallest index of
+/// such a clause, and stores the model in model, or returns -1, if all clauses are implied.
+static int64_t find_not_implied_clause(const Formula &common, const Formula &f1, const Formula &f2, Var maxV,
+                                       int threads, std::vector<lbool> &model)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Solver solver;
+    while (solver.nVars() < maxV) solver.newVar();
+    for (const auto &c : common.clauses) solver.addClause(c);
+    for (const auto &c : f1.clauses) solver.addClause(c);
+    if (!solver.okay()) {
+        std::cerr << "c formula is unsatisfiable, and implies all clauses" << std::endl;
+        return -1;
+    }
+
+    if ((size_t)threads > f2.clauses.size()) threads = f2.clauses.size() > 0 ? f2.clauses.size() : 1;
+    std::vector<Solver> solvers(threads, solver);
+    std::atomic<size_t> next(0);
+    std::atomic<int64_t> bound(f2.clauses.size()); // no need to check clauses after a found one
+    std::mutex model_mutex;
+    parallel_for(threads, threads, [&](int t) {
+        std::vector<Lit> assumptions;
+        for (int64_t i = next++; i < bound; i = next++) {
+            assumptions.clear();
+            for (Lit l : f2.clauses[i]) assumptions.push_back(~l);
+            if (solvers[t].solve(assumptions) != l_True) continue;
+
+            std::lock_guard<std::mutex> lock(model_mutex);
+            if (i < bound) {
+                bound = i;
+                model = solvers[t].model;
+            }
+        }
+    });
+
+    uint64_t conflicts = 0;
+    for (const Solver &s : solvers) conflicts += s.conflicts;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "c checked " << std::min<size_t>(next, f2.clauses.size()) << " clauses with " << conflicts
+              << " conflicts in " << seconds << " s" << std::endl;
+    return bound < (int64_t)f2.clauses.size() ? (int64_t)bound : -1;
+}
+
+/// print that formula 'direction' does not imply the given clause of the other formula to
+/// output_file (default: stdout), with the model of this formula that falsifies the clause
+static void print_counterexample(int direction, ConstClause clause, const std::vector<lbool> &model, Var maxV,
+                                 const std::string &output_file)
+{
+    DimacsWriter out(output_file, 1);
+    std::stringstream comment;
+    comment << "formula " << direction << " does not imply the clause " << clause << "0 of formula " << 3 - direction;
+    out.comment(comment.str());
+    out.put("s NOT EQUIVALENT\n");
+    for (Var v = 0; v < maxV; ++v) {
+        if (v % 10 == 0) out.put(v == 0 ? "v" : "\nv");
+        out.put(" ");
+        out.putLit(mkLit(v, model[v] == l_False));
+    }
+    out.put(maxV % 10 == 0 && maxV > 0 ? "\nv 0\n" : " 0\n");
+}
+
+/// Decide equivalence with the built-in solver, instead of writing a miter: each clause of each
+/// formula that is not shared has to be implied by the other formula. Prints the result to
+/// output_file (default: stdout),
+/// for differing formulas with a model of one formula that falsifies a clause of the other.
+/// Returns 10, if the formulas differ, and 20 if they are equivalent, like the miter.
+int check_equivalence(const Formula &common, const Formula &f1, const Formula &f2, Var maxV, const std::string &output_file, int threads)
+{
+    std::vector<lbool> model;
+    int64_t clause = -1;
+    int direction;
+    for (direction = 1; direction <= 2 && clause < 0; ++direction) {
+        std::cerr << "c check whether formula " << direction << " implies formula " << 3 - direction << std::endl;
+        clause = direction == 1 ? find_not_implied_clause(common, f1, f2, maxV, threads, model) :
+                                  find_not_implied_clause(common, f2, f1, maxV, threads, model);
+    }
+
+    if (clause < 0) {
+        DimacsWriter out(output_file, 1);
+        out.put("s EQUIVALENT\n");
+        return 20;
+    }
+
+    direction--;
+    print_counterexample(direction, (direction == 1 ? f2 : f1).clauses[clause], model, maxV, output_file);
+    return 10;
+}
+
+/// Look for an assignment that satisfies (common & fa), but falsifies a clause of fb, until the
+/// deadline, or until stop is set: first on random assignments, then on models of fa found by
+/// local search, which are perturbed to find further models. Assignments are checked 64 at a time.
+/// Returns the index of the falsified clause of fb, and stores the assignment in model, or -1.
+static int64_t sample_counterexample(const Formula &common, const Formula &fa, const Formula &fb, Var maxV, int direction,
+                                     std::chrono::steady_clock::time_point deadline, std::atomic<bool> &stop,
+                                     std::vector<lbool> &model)
+{
+    std::vector<uint64_t> values(maxV);
+    Random rng(1234 + direction);
+
+    // returns the index of a falsified clause of fb, for the first suitable assignment in mask
+    auto check = [&](uint64_t mask) -> int64_t {
+        mask = satisfied_assignments(fa.clauses, values, mask);
+        mask = satisfied_assignments(common.clauses, values, mask);
+        mask &= ~satisfied_assignments(fb.clauses, values, mask);
+        if (mask == 0) return -1;
+        int k = __builtin_ctzll(mask);
+        model.resize(maxV);
+        for (Var v = 0; v < maxV; ++v) model[v] = lbool((bool)((values[v] >> k) & 1));
+        return first_falsified_clause(fb.clauses, values, k);
+    };
+
+    for (int round = 0; round < 16; ++round) {
+        for (Var v = 0; v < maxV; ++v) values[v] = rng.next();
+        int64_t clause = check(~0ULL);
+        if (clause >= 0) return clause;
+    }
+
+    WalkSAT walk(maxV, rng.next());
+    walk.addClauses(common.clauses);
+    walk.addClauses(fa.clauses);
+    walk.init();
+    auto stopped = [&]() { return stop || std::chrono::steady_clock::now() > deadline; };
+
+    int models = 0;
+    uint64_t checked = 0;
+    bool searching = true;
+    while (searching) {
+        searching = !stopped() && walk.search(stopped);
+        if (searching) {
+            for (Var v = 0; v < maxV; ++v) {
+                values[v] &= ~(1ULL << models);
+                values[v] |= (uint64_t)walk.value(v) << models;
+            }
+            models++;
+            walk.perturb(1 + rng.below(maxV / 100 + 1));
+        }
+        if (models == 64 || (!searching && models > 0)) {
+            int64_t clause = check(models == 64 ? ~0ULL : (1ULL << models) - 1);
+            checked += models;
+            models = 0;
+            if (clause >= 0) return clause;
+        }
+    }
+    fprintf(stderr, "c sampled %llu models of formula %d with %llu flips\n", (unsigned long long)checked, direction,
+            (unsigned long long)walk.flips);
+    return -1;
+}
+
+/// Search for a counterexample to equivalence by sampling, in both directions, within the given
+/// time. Both directions run at the same time, if there are multiple threads. Prints a found
+/// counterexample like check_equivalence, and returns true in this case.
+bool precheck_equivalence(const Formula &common, const Formula &f1, const Formula &f2, Var maxV, double seconds,
+                          const std::string &output_file, int threads)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<bool> stop(false);
+    std::vector<lbool> models[2];
+    int64_t clauses[2] = {-1, -1};
+
+    parallel_for(2, threads, [&](int d) {
+        // without a second thread, each direction gets half of the time
+        double share = threads > 1 ? seconds : seconds * (d + 1) / 2;
+        auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(share));
+        clauses[d] = d == 0 ? sample_counterexample(common, f1, f2, maxV, 1, deadline, stop, models[d]) :
+                              sample_counterexample(common, f2, f1, maxV, 2, deadline, stop, models[d]);
+        if (clauses[d] >= 0) stop = true;
+    });
+
+    for (int d = 0; d < 2; ++d) {
+        if (clauses[d] < 0) continue;
+        std::cerr << "c found counterexample by sampling after "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+        print_counterexample(d + 1, (d == 0 ? f2 : f1).clauses[clauses[d]], models[d], maxV, output_file);
+        return true;
+    }
+    return false;
+}
+
+/// All settings of one comparison, as given on the command line, or in a line of a batch file.
+struct Options {
     int tseitin = 0;
-    int randmom_drop = 0;
-    std::cerr << "c CNFmiter generates a CNF formula " << std::endl
-              << "c which is unsatisfiable, if the given 2 formulas are equivalent" << std::endl;
+    bool detect_inputs = false; // -t auto
+    int random_drop = 0;
+    int component_vars = 0;
+    int directional = 0;
+    int partitions = 0;
+    bool partition_literals = false;
+    int threads = default_threads();
+    bool share = true;
+    bool check = false;
+    double precheck = 0;
+    std::string output_file;
+    std::string batch_file;
+    std::string cache_dir;
+    std::string simplifier;
+    std::string file1, file2;
+};
 
+/// parse the command line arguments into o, and report each option on stderr, if verbose. Prints
+/// an error message, and returns false for invalid arguments.
+static bool parse_options(int argc, char **argv, Options &o, bool verbose)
+{
+    enum { OPT_CHECK = 256, OPT_PRECHECK, OPT_BATCH, OPT_CACHE_DIR, OPT_SIMPLIFIER };
+    static const struct option long_options[] = {{"batch", required_argument, NULL, OPT_BATCH},
+                                                 {"cache-dir", required_argument, NULL, OPT_CACHE_DIR},
+                                                 {"check", no_argument, NULL, OPT_CHECK},
+                                                 {"precheck", required_argument, NULL, OPT_PRECHECK},
+                                                 {"simplifier", required_argument, NULL, OPT_SIMPLIFIER},
+                                                 {NULL, 0, NULL, 0}};
+    std::ostream quiet(NULL); // discards all output
+    std::ostream &log = verbose ? std::cerr : quiet;
 
-    // Retrieve the options:
-    while ((opt = getopt(argc, argv, "r:t:")) != -1) { // for each option...
+    int opt;
+    optind = 0; // parse from the start, also when called again
+    while ((opt = getopt_long(argc, argv, "C:D:j:Lo:P:r:St:", long_options, NULL)) != -1) { // for each option...
         switch (opt) {
+        case OPT_BATCH:
+            o.batch_file = optarg;
+            log << "c run the jobs of batch file " << o.batch_file << std::endl;
+            break;
+        case OPT_CACHE_DIR:
+            o.cache_dir = optarg;
+            log << "c cache parsed formulas in " << o.cache_dir << std::endl;
+            break;
+        case OPT_CHECK:
+            o.check = true;
+            log << "c check equivalence with the built-in solver" << std::endl;
+            break;
+        case OPT_PRECHECK:
+            o.precheck = atof(optarg);
+            log << "c look for counterexamples by sampling for up to " << o.precheck << " seconds" << std::endl;
+            break;
+        case OPT_SIMPLIFIER:
+            o.simplifier = optarg;
+            log << "c compare the input with its simplification by: " << o.simplifier << std::endl;
+            break;
+        case 'C':
+            o.component_vars = atoi(optarg);
+            log << "c write a miter per component, with at least " << o.component_vars << " variables" << std::endl;
+            break;
+        case 'D':
+            o.directional = atoi(optarg);
+            log << "c write implication checks " << (o.directional == 2 ? "as two formulas" : "with a selector") << std::endl;
+            break;
+        case 'j':
+            o.threads = atoi(optarg);
+            log << "c use " << o.threads << " threads" << std::endl;
+            break;
+        case 'L':
+            o.partition_literals = true;
+            log << "c balance parts by number of literals" << std::endl;
+            break;
+        case 'o':
+            o.output_file = optarg;
+            log << "c write miter to " << o.output_file << std::endl;
+            break;
+        case 'P':
+            o.partitions = atoi(optarg);
+            log << "c split implication checks into " << o.partitions << " parts" << std::endl;
+            break;
         case 'r':
-            randmom_drop = atoi(optarg);
-            std::cerr << "c randomly drop " << randmom_drop << " clauses from first formula" << std::endl;
+            o.random_drop = atoi(optarg);
+            log << "c randomly drop " << o.random_drop << " clauses from first formula" << std::endl;
+            break;
+        case 'S':
+            o.share = false;
+            log << "c do not share common clauses" << std::endl;
             break;
         case 't':
-            tseitin = atoi(optarg);
-            std::cerr << "c set tseitin variable to " << tseitin << std::endl;
+            if (strcmp(optarg, "auto") == 0) {
+                o.detect_inputs = true;
+                log << "c detect the input variables" << std::endl;
+            } else {
+                o.tseitin = atoi(optarg);
+                log << "c set tseitin variable to " << o.tseitin << std::endl;
+            }
             break;
         case '?': // unknown option...
             std::cerr << "c unknown option: '" << char(optopt) << "'!" << std::endl;
-            exit(1);
-            break;
+            return false;
         }
     }
 
-    if (optind + 2 != argc) {
+    if (!o.batch_file.empty()) {
+        if (optind != argc) {
+            std::cerr << "no input files can be given in batch mode, abort!" << std::endl;
+            return false;
+        }
+    } else if (!o.simplifier.empty()) {
+        if (optind + 1 != argc) {
+            std::cerr << "a simplifier needs exactly one input file, abort!" << std::endl;
+            return false;
+        }
+        o.file1 = argv[optind];
+    } else if (optind + 2 != argc) {
         std::cerr << "not enough parameters, abort!" << std::endl;
-        return 1;
+        return false;
+    } else {
+        o.file1 = argv[optind + 0];
+        o.file2 = argv[optind + 1];
     }
 
-    std::string fn1 = (argv[optind + 0]);
-    std::string fn2 = (argv[optind + 1]);
-    gzFile in1 = gzopen(fn1.c_str(), "rb");
-    gzFile in2 = gzopen(fn2.c_str(), "rb");
+    if (o.tseitin < 0) {
+        std::cerr << "tseitin variable negative, abort" << std::endl;
+        return false;
+    }
+    if (o.random_drop < 0) {
+        std::cerr << "random_drop value negative, abort" << std::endl;
+        return false;
+    }
+    if (o.component_vars < 0 || (o.component_vars > 0 && o.output_file.empty())) {
+        std::cerr << "component miters require a positive size and an output file (-o), abort" << std::endl;
+        return false;
+    }
+    if (o.directional < 0 || o.directional > 2 || (o.directional == 2 && o.output_file.empty())) {
+        std::cerr << "implication checks need 1 (selector) or 2 (two files, with -o), abort" << std::endl;
+        return false;
+    }
+    if (o.partitions < 0 || (o.partitions > 0 && o.output_file.empty())) {
+        std::cerr << "partitioned checks require a positive number of parts and an output file (-o), abort" << std::endl;
+        return false;
+    }
+    if ((o.directional > 0) + (o.component_vars > 0) + (o.partitions > 0) + o.check > 1) {
+        std::cerr << "only one of -C, -D, -P and --check can be used, abort" << std::endl;
+        return false;
+    }
+    if (o.precheck < 0) {
+        std::cerr << "precheck time negative, abort" << std::endl;
+        return false;
+    }
+    if (o.threads < 1) {
+        std::cerr << "number of threads has to be positive, abort" << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    if (!in1) {
-        std::cerr << "failed to open first file, abort!" << std::endl;
-        return 1;
+/// A parsed formula, together with its normalized form and the hashes of the normalized clauses,
+/// which are computed on first use, once. Unless keep_parsed is set, the parsed formula is
+/// normalized in place, and is empty afterwards.
+class CachedFormula
+{
+    std::once_flag normalize_once, hash_once;
+    Formula normalized_formula;
+    NormalizeStats stats;
+    std::vector<ClauseKey> keys;
+
+    public:
+    bool parsed = false;
+    bool keep_parsed = true;
+    Formula formula;
+
+    const Formula &normalized(int threads, NormalizeStats &s)
+    {
+        std::call_once(normalize_once, [&]() {
+            if (keep_parsed)
+                normalized_formula = formula;
+            else {
+                normalized_formula = std::move(formula);
+                formula = Formula();
+            }
+            stats = normalize_formula(normalized_formula, threads);
+        });
+        s = stats;
+        return normalized_formula;
     }
-    if (!in2) {
-        std::cerr << "failed to open second file, abort!" << std::endl;
-        return 1;
+
+    const std::vector<ClauseKey> &hashes(int threads)
+    {
+        std::call_once(hash_once, [&]() { hash_clauses(normalized_formula.clauses, keys, threads); });
+        return keys;
     }
-    if (tseitin < 0) {
-        std::cerr << "tseitin variable negative, abort" << std::endl;
-        return 1;
+};
+
+/// Formulas that are used by multiple jobs of a batch are parsed, normalized and hashed only once.
+/// All uses are announced before, and an entry is dropped, once its last user released it. The
+/// parsed formula is only kept next to the normalized one, if a job uses it.
+class FormulaCache
+{
+    struct Entry {
+        std::once_flag parse_once;
+        std::shared_ptr<CachedFormula> formula = std::make_shared<CachedFormula>();
+        int users = 0;
+        int parsed_users = 0;
+    };
+    std::mutex mutex;
+    std::map<std::string, std::shared_ptr<Entry> > entries;
+
+    std::shared_ptr<Entry> entry(const std::string &file)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<Entry> &e = entries[file];
+        if (!e) e = std::make_shared<Entry>();
+        return e;
     }
-    if (randmom_drop < 0) {
-        std::cerr << "random_drop value negative, abort" << std::endl;
-        return 1;
+
+    public:
+    void announce(const std::string &file, bool uses_parsed)
+    {
+        std::shared_ptr<Entry> e = entry(file);
+        e->users++;
+        e->parsed_users += uses_parsed;
+    }
+
+    std::shared_ptr<CachedFormula> get(const std::string &file, int threads, const std::string &cache_dir)
+    {
+        std::shared_ptr<Entry> e = entry(file);
+        std::call_once(e->parse_once, [&]() {
+            e->formula->parsed = read_formula(file.c_str(), e->formula->formula, threads, cache_dir);
+            e->formula->keep_parsed = e->parsed_users > 0;
+        });
+        return e->formula;
+    }
+
+    void release(const std::string &file)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(file);
+        if (it != entries.end() && --it->second->users <= 0) entries.erase(it);
+    }
+};
+
+/// name of a file without its directory, and without a ".gz" extension
+static std::string base_name(const std::string &file)
+{
+    std::string name = file.substr(file.rfind('/') == std::string::npos ? 0 : file.rfind('/') + 1);
+    if (name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0) name.resize(name.size() - 3);
+    return name;
+}
+
+/// Read the input of o into f1, and simplify it with the simplifier of o into f2. The comments
+/// that describe the simplification, including the output of the simplifier, are stored in
+/// preamble; lines that contain the name of the user are dropped. Returns false on errors.
+static bool simplify_input(const Options &o, Formula &f1, Formula &f2, std::vector<std::string> &preamble)
+{
+    if (!read_formula(o.file1.c_str(), f1, o.threads, o.cache_dir)) {
+        std::cerr << "failed to open first file, abort!" << std::endl;
+        return false;
+    }
+
+    std::string log;
+    int status = run_simplifier(o.simplifier, f1, f1.nVars(), f2, log);
+    std::cerr << "c simplification returned with " << status << std::endl;
+    if (status != 0 && status != 10 && status != 20) {
+        std::cerr << "c exit, due to simplification status " << status << std::endl;
+        return false;
     }
 
+    std::vector<std::string> lines = {"CNF simplfication miter, 2020, Norbert Manthey",
+                                      "",
+                                      "This CNF has been generated from a given CNF input file " + base_name(o.file1),
+                                      "From this file, the simplifier produced an equivalent, eventually simplified,",
+                                      "CNF. From the original, and simplified formula, a miter formula is generated,",
+                                      "that is unsatisfiable if and only if the original and simplified formula are",
+                                      "actually equivalent.",
+                                      "",
+                                      "The simplifier command was: " + o.simplifier,
+                                      "",
+                                      "miter input file: " + o.file1,
+                                      "",
+                                      "simplifier output"};
+    std::stringstream output(log);
+    for (std::string line; std::getline(output, line);)
+        lines.push_back(line.compare(0, 2, "c ") == 0 ? line.substr(2) : line == "c" ? "" : line);
+    lines.push_back("simplifier status: " + std::to_string(status));
+
+    const char *user = getenv("USER");
+    preamble.clear();
+    for (const std::string &line : lines)
+        if (!user || !*user || line.find(user) == std::string::npos) preamble.push_back(line);
+    return true;
+}
+
+/// without changes before the normalization, a job can use the normalized formulas of the cache
+static bool uses_normalized_input(const Options &o)
+{
+    return o.random_drop == 0 && o.tseitin == 0 && !o.detect_inputs;
+}
+
+/// Compare the two formulas of o, as selected by the options. Formulas are taken from the cache,
+/// if one is given. Returns the exit code: 10 or 20 for the result of a check, 0 after writing
+/// a miter, and 1 on errors.
+int run_job(const Options &o, FormulaCache *cache)
+{
+    const int threads = o.threads;
+    std::string fn1 = o.file1, fn2 = o.file2;
     Formula f1, f2;
+    std::shared_ptr<CachedFormula> cached1, cached2;
+    bool parsed1 = false, parsed2 = false;
+    std::vector<std::string> preamble;
 
-    parse_DIMACS(in1, f1);
-    gzclose(in1);
+    if (!o.simplifier.empty()) {
+        if (!simplify_input(o, f1, f2, preamble)) return 1;
+        fn2 = "simplified-" + base_name(fn1);
+        parsed1 = parsed2 = true;
+        cache = NULL; // the simplified formula is not a file
+    } else if (cache) {
+        cached1 = cache->get(fn1, threads, o.cache_dir);
+        cached2 = cache->get(fn2, threads, o.cache_dir);
+        parsed1 = cached1->parsed;
+        parsed2 = cached2->parsed;
+    } else if (threads == 1) {
+        parsed1 = read_formula(fn1.c_str(), f1, 1, o.cache_dir);
+        parsed2 = parsed1 && read_formula(fn2.c_str(), f2, 1, o.cache_dir);
+    } else {
+        // parse both formulas at the same time, each with half of the threads
+        int parse_threads = threads / 2;
+        std::thread parse2([&]() { parsed2 = read_formula(fn2.c_str(), f2, parse_threads, o.cache_dir); });
+        parsed1 = read_formula(fn1.c_str(), f1, threads - parse_threads, o.cache_dir);
+        parse2.join();
+    }
 
-    parse_DIMACS(in2, f2);
-    gzclose(in2);
+    if (!parsed1) {
+        std::cerr << "failed to open first file, abort!" << std::endl;
+        return 1;
+    }
+    if (!parsed2) {
+        std::cerr << "failed to open second file, abort!" << std::endl;
+        return 1;
+    }
 
-    std::cerr << "c Parsed formulas 1 with " << f1.nVars() << " vars and " << f1.clauses.size()
-              << " and formulas 2 with " << f2.nVars() << " vars and " << f2.clauses.size() << std::endl;
+    // the normalized formulas of the cache are not copied, only their clauses that are not shared
+    bool use_normalized = cache && uses_normalized_input(o);
+    NormalizeStats stats[2];
+    if (cache && !use_normalized) {
+        f1 = cached1->formula;
+        f2 = cached2->formula;
+    }
+    const Formula &in1 = use_normalized ? cached1->normalized(threads, stats[0]) : f1;
+    const Formula &in2 = use_normalized ? cached2->normalized(threads, stats[1]) : f2;
 
-    if (randmom_drop > 0) {
-        srand(1234);
-        for (int i = 0; i < randmom_drop && f1.clauses.size() > 0; ++i) {
-            size_t p = rand() % f1.clauses.size();
-            f1.clauses[p] = f1.clauses.back();
-            f1.clauses.pop_back();
+    std::cerr << "c Parsed formulas 1 with " << in1.nVars() << " vars and " << in1.clauses.size()
+              << " and formulas 2 with " << in2.nVars() << " vars and " << in2.clauses.size() << std::endl;
+
+    if (o.random_drop > 0) {
+        // replace dropped clauses by the last clause, then compact the clauses once
+        std::vector<size_t> order(f1.clauses.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        Random rng(1234); // per job, as batch jobs run concurrently; drops other clauses than rand() did
+        for (int i = 0; i < o.random_drop && order.size() > 0; ++i) {
+            size_t p = rng.below(order.size());
+            order[p] = order.back();
+            order.pop_back();
         }
+        f1.clauses.select(order);
     }
 
-    Formula miter;
-
+    int tseitin = o.tseitin;
+    Formula definitions; // shared gate definitions of auxiliary variables
     Var maxV = f1.nVars() > f2.nVars() ? f1.nVars() : f2.nVars();
-    if (tseitin > 0) {
-        int offset = tseitin;
-        offset = maxV > tseitin ? maxV - tseitin : 0;
-        std::cerr << "c offset " << offset << " tseitin: " << tseitin << " maxV: " << maxV << std::endl;
-        assert(offset == 0 || f2.nVars() <= tseitin || f2.nVars() + offset > f1.nVars());
 
-        rewrite_variable_range(f2, tseitin, offset);
+    // the variables both formulas are compared on, all other variables are auxiliary
+    std::vector<char> input;
+    if (o.detect_inputs) {
+        const char *source = detect_input_variables({&f1, &f2}, maxV, input);
+        std::cerr << "c detected " << std::count(input.begin(), input.end(), 1) << " of " << maxV
+                  << " variables as inputs, from " << source << std::endl;
+    } else if (tseitin > 0) {
+        input.assign(maxV, 0);
+        std::fill(input.begin(), input.begin() + std::min(tseitin, maxV), 1);
+    }
+
+    if (!input.empty()) {
+        // move the auxiliary variables of f2 behind the variables of f1, and behind all inputs
+        Var next = f1.nVars();
+        for (Var v = 0; v < f2.nVars(); ++v)
+            if (input[v] && v >= next) next = v + 1;
+        std::vector<Var> map2(f2.nVars(), var_Undef);
+        Var first = next;
+        for (Var v = 0; v < f2.nVars(); ++v)
+            if (input[v]) map2[v] = v;
 
-        maxV = f1.nVars() > f2.nVars() ? f1.nVars() : f2.nVars();
+        // gates are encoded once, for both formulas, all other clauses with auxiliary variables are exchanged
+        std::vector<char> gate_defined(std::max(maxV, first + f2.nVars()), 0);
+        GateTable known;
+        for (int i = 0; i < 2; ++i) {
+            size_t counts[GATE_TYPES] = {0}, clauses = definitions.nClauses(), merged = 0;
+            size_t gates = extract_gate_definitions(i == 0 ? f1 : f2, input, i == 0 ? NULL : &map2, next, known,
+                                                    definitions, gate_defined, counts, merged);
+            std::stringstream types;
+            for (int t = 0; t < GATE_TYPES; ++t) types << (t ? ", " : "") << counts[t] << " " << gate_type_names[t];
+            std::cerr << "c recognized " << gates << " gates (" << types.str() << ") in formula " << i + 1
+                      << (i ? ", merged " + std::to_string(merged) + " with equal gates of formula 1" : std::string())
+                      << ", shared their " << definitions.nClauses() - clauses << " clauses" << std::endl;
+        }
+        std::cerr << "c move " << next - first << " auxiliary variables of formula 2 to " << first + 1
+                  << " and above" << std::endl;
 
-        while (f1.nVars() < maxV) f1.newVar();
-        while (f2.nVars() < maxV) f2.newVar();
+        maxV = f1.nVars() > next ? f1.nVars() : next;
+        input.resize(maxV, 0);
+        gate_defined.resize(maxV);
 
-        exchange_definition_clauses(f1, f2, tseitin);
+        f1.ensureVars(maxV);
+        f2.ensureVars(maxV);
+        exchange_definition_clauses(f1, f2, input, &gate_defined);
     }
 
-    maxV = f1.nVars() > f2.nVars() ? f1.nVars() : f2.nVars();
-    while (miter.nVars() < maxV) miter.newVar();
+    maxV = in1.nVars() > in2.nVars() ? in1.nVars() : in2.nVars();
 
-    std::cerr << "c Miter base formulas reserved " << miter.nVars() << " variables" << std::endl;
+    for (int i = 0; i < 2; ++i) {
+        if (!use_normalized) stats[i] = normalize_formula(i == 0 ? f1 : f2, threads);
+        const Formula &f = i == 0 ? in1 : in2;
+        size_t units = 0, binaries = 0;
+        for (const auto &c : f.clauses) units += c.size() == 1, binaries += c.size() == 2;
+        std::cerr << "c formula " << i + 1 << ": removed " << stats[i].duplicates << " duplicate clauses, "
+                  << stats[i].tautologies << " tautologies and " << stats[i].duplicate_literals << " duplicate literals, "
+                  << f.clauses.size() << " distinct clauses with " << units << " units and " << binaries
+                  << " binary clauses remain" << std::endl;
+    }
 
-    generate_formula_miter(miter, f1, f2);
+    Formula common;
+    size_t clauses1 = in1.clauses.size(), clauses2 = in2.clauses.size(), shared = 0;
+    if (use_normalized && o.share) {
+        std::vector<size_t> keep1, keep2;
+        shared = find_common_clauses(in1, in2, common, keep1, keep2, threads, &cached1->hashes(threads),
+                                     &cached2->hashes(threads));
+        f1.ensureVars(in1.nVars());
+        f2.ensureVars(in2.nVars());
+        f1.clauses.select(in1.clauses, keep1);
+        f2.clauses.select(in2.clauses, keep2);
+    } else if (use_normalized) {
+        f1 = in1;
+        f2 = in2;
+    } else if (o.share)
+        shared = share_common_clauses(f1, f2, common, threads);
+    if (o.share) {
+        std::cerr << "c shared " << shared << " common clauses as hard clauses, removed " << clauses1 - f1.clauses.size()
+                  << " of " << clauses1 << " clauses from formula 1 and " << clauses2 - f2.clauses.size() << " of "
+                  << clauses2 << " clauses from formula 2" << std::endl;
+    }
+    for (const auto &c : definitions.clauses) common.addClause_(c);
 
     std::size_t found = fn1.rfind("/");
     if (found != std::string::npos) fn1 = fn1.erase(0, found + 1);
@@ -244,8 +1388,116 @@ int main(int argc, char **argv)
     std::stringstream s;
     s << fn1 << " and " << fn2;
     if (tseitin != 0) s << " with tseitin base variable " << tseitin;
-    if (randmom_drop) s << " with randomly dropping " << randmom_drop;
-    print_formula(miter, s.str());
+    if (o.detect_inputs) s << " with detected input variables";
+    if (o.random_drop) s << " with randomly dropping " << o.random_drop;
+    if (o.precheck > 0 && precheck_equivalence(common, f1, f2, maxV, o.precheck, o.output_file, threads)) return 10;
+    if (o.check) return check_equivalence(common, f1, f2, maxV, o.output_file, threads);
+
+    if (o.directional > 0) {
+        if (!print_implication_miters(common, f1, f2, maxV, s.str(), o.output_file, o.directional == 2, threads)) {
+            std::cerr << "failed to open output file, abort!" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (o.partitions > 0) {
+        if (!print_partitioned_miters(common, f1, f2, maxV, s.str(), o.output_file, o.partitions, o.partition_literals, threads)) {
+            std::cerr << "failed to open output file, abort!" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (o.component_vars > 0) {
+        if (!print_component_miters(common, f1, f2, maxV, s.str(), o.output_file, o.component_vars, threads)) {
+            std::cerr << "failed to open output file, abort!" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!print_miter(common, f1, f2, maxV, s.str(), o.output_file, threads, true, &preamble)) {
+        std::cerr << "failed to open output file, abort!" << std::endl;
+        return 1;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
+
+/// Run all jobs of a batch file, where each line holds the arguments of one call, e.g.
+/// "-t 4 -o miter.cnf f1.cnf f2.cnf". Empty lines, and lines that start with 'c' or '#' are
+/// skipped. Options given on the command line are the defaults of all jobs, except for -j, which
+/// is the number of jobs that run at the same time; each job uses a single thread, unless its
+/// line selects more. Each job has to write to its own output file. Returns 1, if a job failed.
+int run_batch(const Options &defaults)
+{
+    std::ifstream in(defaults.batch_file.c_str());
+    if (!in) {
+        std::cerr << "failed to open batch file " << defaults.batch_file << ", abort!" << std::endl;
+        return 1;
+    }
+
+    std::vector<Options> jobs;
+    std::vector<std::string> lines;
+    std::string line;
+    for (int number = 1; std::getline(in, line); ++number) {
+        std::stringstream tokens(line);
+        std::vector<std::string> args(1, "cnfmiter");
+        std::string token;
+        while (tokens >> token) args.push_back(token);
+        if (args.size() == 1 || args[1][0] == 'c' || args[1][0] == '#') continue;
+
+        std::vector<char *> argv;
+        for (std::string &a : args) argv.push_back(&a[0]);
+        argv.push_back(NULL);
+        Options o = defaults;
+        o.threads = 1;
+        o.batch_file.clear();
+        if (!parse_options(argv.size() - 1, argv.data(), o, false) || !o.batch_file.empty() || o.output_file.empty()) {
+            std::cerr << "invalid job in line " << number << " of batch file, each job needs an output file (-o), abort!" << std::endl;
+            return 1;
+        }
+        jobs.push_back(o);
+        lines.push_back(line);
+    }
+
+    FormulaCache cache;
+    for (const Options &o : jobs) {
+        cache.announce(o.file1, !uses_normalized_input(o));
+        cache.announce(o.file2, !uses_normalized_input(o));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<int> status(jobs.size(), 1);
+    parallel_for(jobs.size(), defaults.threads, [&](int i) {
+        std::chrono::steady_clock::time_point job_start = std::chrono::steady_clock::now();
+        status[i] = run_job(jobs[i], &cache);
+        cache.release(jobs[i].file1);
+        cache.release(jobs[i].file2);
+        fprintf(stderr, "c job %d (%s) finished with exit code %d in %.3f s\n", i + 1, lines[i].c_str(), status[i],
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - job_start).count());
+    });
+
+    int failed = 0;
+    for (int s : status) failed += s != 0 && s != 10 && s != 20;
+    std::cerr << "c finished " << jobs.size() << " jobs in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s, " << failed
+              << " failed" << std::endl;
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::cerr << "c CNFmiter generates a CNF formula " << std::endl
+              << "c which is unsatisfiable, if the given 2 formulas are equivalent" << std::endl;
+
+    // Retrieve the options:
+    Options o;
+    if (!parse_options(argc, argv, o, true)) return 1;
+    // a simplifier might stop reading its input early, which must not terminate this process
+    if (!o.simplifier.empty() || !o.batch_file.empty()) signal(SIGPIPE, SIG_IGN);
+
+    if (!o.batch_file.empty()) return run_batch(o);
+    return run_job(o, NULL);
+}
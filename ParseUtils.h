@@ -23,35 +23,120 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include <zlib.h>
 
+#include "IntTypes.h"
+
 namespace CNFMITER
 {
 
 //-------------------------------------------------------------------------------------------------
 // A simple buffered character stream class:
+//
+// The stream is inflated by a background thread into a ring of blocks, so that decompression of
+// the next blocks overlaps with parsing the current one.
 
 static const int buffer_size = 1048576;
+static const int pipeline_blocks = 3; // blocks in flight between inflater and parser
 
 
 class StreamBuffer
 {
     gzFile in;
-    unsigned char buf[buffer_size];
+    unsigned char *ring; // pipeline_blocks blocks of buffer_size bytes
+    int sizes[pipeline_blocks];
+    int produced; // number of blocks filled by the inflater
+    int released; // number of blocks the parser is done with
+    bool stop;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread inflater;
+
+    unsigned char *buf; // the current block
+    int next;           // index of the next block to parse
+    bool eof;
     int pos;
     int size;
+    uint64_t consumed; // number of bytes read from the stream so far
 
-    void assureLookahead()
+    StreamBuffer(const StreamBuffer &);
+    StreamBuffer &operator=(const StreamBuffer &);
+
+    void inflate()
     {
-        if (pos >= size) {
-            pos = 0;
-            size = gzread(in, buf, sizeof(buf));
+        for (int b = 0;; ++b) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return stop || b - released < pipeline_blocks; });
+                if (stop) return;
+            }
+            int n = gzread(in, ring + (size_t)(b % pipeline_blocks) * buffer_size, buffer_size);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                sizes[b % pipeline_blocks] = n;
+                produced = b + 1;
+            }
+            changed.notify_all();
+            if (n <= 0) return;
         }
     }
 
+    void assureLookahead()
+    {
+        if (pos < size || eof) return;
+        std::unique_lock<std::mutex> lock(mutex);
+        released = next; // done with the current block, the inflater can refill it
+        changed.notify_all();
+        changed.wait(lock, [&]() { return produced > next; });
+        buf = ring + (size_t)(next % pipeline_blocks) * buffer_size;
+        size = sizes[next % pipeline_blocks];
+        pos = 0;
+        next++;
+        if (size > 0)
+            consumed += size;
+        else
+            size = 0, eof = true;
+    }
+
     public:
-    explicit StreamBuffer(gzFile i) : in(i), pos(0), size(0) { assureLookahead(); }
+    explicit StreamBuffer(gzFile i)
+    : in(i)
+    , ring(new unsigned char[(size_t)pipeline_blocks * buffer_size])
+    , produced(0)
+    , released(0)
+    , stop(false)
+    , buf(ring)
+    , next(0)
+    , eof(false)
+    , pos(0)
+    , size(0)
+    , consumed(0)
+    {
+        inflater = std::thread(&StreamBuffer::inflate, this);
+        assureLookahead();
+    }
+
+    ~StreamBuffer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        changed.notify_all();
+        inflater.join();
+        delete[] ring;
+    }
 
     int operator*() const { return (pos >= size) ? EOF : buf[pos]; }
     void operator++()
@@ -60,6 +145,86 @@ class StreamBuffer
         assureLookahead();
     }
     int position() const { return pos; }
+    uint64_t bytes() const { return consumed; }
+
+    // Direct access to the buffered bytes [current(), limit()), for bulk parsing:
+    const unsigned char *current() const { return buf + pos; }
+    const unsigned char *limit() const { return buf + size; }
+    void skip(int n)
+    {
+        pos += n;
+        assureLookahead();
+    }
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// A read-only memory mapping of a whole file:
+
+
+class MappedFile
+{
+    const unsigned char *data;
+    size_t length;
+
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    public:
+    // Maps the given file, if it is a regular file. Otherwise, the mapping stays invalid and the
+    // file has to be read via a stream.
+    explicit MappedFile(const char *filename) : data(NULL), length(0)
+    {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                data = (const unsigned char *)m;
+                length = st.st_size;
+                madvise(m, length, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (data) munmap((void *)data, length);
+    }
+
+    bool valid() const { return data != NULL; }
+    const unsigned char *begin() const { return data; }
+    size_t size() const { return length; }
+
+    // The file starts with the gzip magic bytes, i.e. it has to be inflated before parsing.
+    bool isGzip() const { return length >= 2 && data[0] == 0x1f && data[1] == 0x8b; }
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// A character stream over a memory region, e.g. a mapped file (no copying, no refills):
+
+
+class MappedBuffer
+{
+    const unsigned char *buf;
+    size_t size;
+    size_t pos;
+
+    public:
+    MappedBuffer(const unsigned char *b, size_t s) : buf(b), size(s), pos(0) {}
+
+    int operator*() const { return (pos >= size) ? EOF : buf[pos]; }
+    void operator++() { pos++; }
+    size_t position() const { return pos; }
+    uint64_t bytes() const { return size; }
+
+    // Direct access to the remaining bytes [current(), limit()), for bulk parsing:
+    const unsigned char *current() const { return buf + pos; }
+    const unsigned char *limit() const { return buf + size; }
+    void skip(size_t n) { pos += n; }
 };
 
 
@@ -68,6 +233,7 @@ class StreamBuffer
 
 
 static inline bool isEof(StreamBuffer &in) { return *in == EOF; }
+static inline bool isEof(MappedBuffer &in) { return *in == EOF; }
 static inline bool isEof(const char *in) { return *in == '\0'; }
 
 //-------------------------------------------------------------------------------------------------
@@ -108,6 +274,98 @@ template <class B> static int parseInt(B &in)
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Bulk integer parsing on buffered bytes:
+//
+// Digits are classified and converted 8 bytes at a time (SWAR), instead of one branch and one EOF
+// check per character. The kernel only works on the window of already buffered bytes, and gives up
+// (without consuming anything) whenever the window is too short or the input looks malformed. The
+// caller then falls back to 'parseInt', which also takes care of reporting errors.
+
+static const int bulk_lookahead = 32; // bytes that have to be available behind the first digit
+
+#if !defined(CNFMITER_SCALAR_PARSE) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && \
+defined(__GNUC__)
+
+// Number of leading ASCII digits in the 8 bytes starting at p.
+static inline int leadingDigits(uint64_t x)
+{
+    const uint64_t high = 0x8080808080808080ULL;
+    uint64_t lo = x & 0x7f7f7f7f7f7f7f7fULL;
+    // per byte: above '9', below '0', or not ASCII at all
+    uint64_t nondigit = ((lo + 0x4646464646464646ULL) | ~(lo + 0x5050505050505050ULL) | x) & high;
+    return nondigit ? __builtin_ctzll(nondigit) >> 3 : 8;
+}
+
+// Value of the first n (1 <= n <= 8) digits in x, first digit in the lowest byte.
+static inline uint32_t convertDigits(uint64_t x, int n)
+{
+    x &= 0x0f0f0f0f0f0f0f0fULL;
+    if (n < 8) x <<= 8 * (8 - n); // the unused bytes become leading zeros
+    x = (x * 10) + (x >> 8);
+    x = (((x & 0x000000ff000000ffULL) * 0x000f424000000064ULL) +
+         (((x >> 16) & 0x000000ff000000ffULL) * 0x0000271000000001ULL)) >>
+        32;
+    return (uint32_t)x;
+}
+
+static inline const unsigned char *parseDigits(const unsigned char *p, uint32_t &val)
+{
+    static const uint32_t pow10[9] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+    uint64_t x;
+    memcpy(&x, p, 8);
+    int n = leadingDigits(x);
+    if (n == 0) return NULL;
+    val = convertDigits(x, n);
+    if (n < 8) return p + n;
+
+    memcpy(&x, p + 8, 8);
+    n = leadingDigits(x);
+    if (n == 8) return NULL; // more than 16 digits, leave that to the scalar path
+    if (n > 0) val = val * pow10[n] + convertDigits(x, n);
+    return p + 8 + n;
+}
+
+#else
+
+static inline const unsigned char *parseDigits(const unsigned char *p, uint32_t &val)
+{
+    if (*p < '0' || *p > '9') return NULL;
+    val = 0;
+    const unsigned char *stop = p + 16;
+    while (p != stop && *p >= '0' && *p <= '9') val = val * 10 + (*p - '0'), ++p;
+    return p == stop ? NULL : p;
+}
+
+#endif
+
+// Parses the next integer from the window [p, end). Returns the position behind the integer, or
+// NULL, if the integer cannot be parsed from the window.
+static inline const unsigned char *parseIntWindow(const unsigned char *p, const unsigned char *end, int &val)
+{
+    if (p != end && *p == ' ') ++p; // the common single separator
+    while (p != end && ((*p >= 9 && *p <= 13) || *p == 32)) ++p;
+    if (end - p < bulk_lookahead) return NULL;
+    int neg = (*p == '-');
+    p += neg | (*p == '+'); // branch free, the sign of literals is random
+    uint32_t u;
+    p = parseDigits(p, u);
+    if (!p) return NULL;
+    val = neg ? -(int)u : (int)u;
+    return p;
+}
+
+// Parses the next integer directly from the buffer window of 'in', if possible.
+template <class B> static inline bool parseIntBulk(B &in, int &val)
+{
+    const unsigned char *start = in.current();
+    const unsigned char *p = parseIntWindow(start, in.limit(), val);
+    if (!p) return false;
+    in.skip(p - start);
+    return true;
+}
+
+
 // String matching: in case of a match the input iterator will be advanced the corresponding
 // number of characters.
 template <class B> static bool match(B &in, const char *str)
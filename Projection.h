@@ -0,0 +1,41 @@
+/************************************************************************************[Projection.h]
+The input variables of formulas, i.e. the projection that miters and model encodings compare on,
+as an arbitrary set of variables: the variables of projection lines, or all variables that are not
+defined by gates.
+**************************************************************************************************/
+
+#ifndef CNFMITER_Projection_h
+#define CNFMITER_Projection_h
+
+#include <vector>
+
+#include "Gates.h"
+#include "SolverTypes.h"
+
+namespace CNFMITER
+{
+
+// Mark the input variables of the given formulas in input, with an entry for each of the vars
+// variables. If any formula has projection lines, the inputs are the variables of these lines of
+// all formulas. Otherwise, each variable that is defined by an acyclic gate in one of the formulas
+// is auxiliary (see clear_gate_outputs). Returns the source of the inputs, for messages.
+static const char *detect_input_variables(const std::vector<const Formula *> &formulas, int vars, std::vector<char> &input)
+{
+    bool declared = false;
+    for (const Formula *f : formulas) declared = declared || !f->projection.empty();
+    if (declared) {
+        input.assign(vars, 0);
+        for (const Formula *f : formulas)
+            for (Var v : f->projection) input[v] = 1;
+        return "projection lines";
+    }
+
+    input.assign(vars, 1);
+    for (const Formula *f : formulas) clear_gate_outputs(*f, input);
+    return "gate definitions";
+}
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
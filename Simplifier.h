@@ -0,0 +1,120 @@
+/*************************************************************************************[Simplifier.h]
+Run an external simplifier, e.g. Coprocessor, on a parsed formula, without temporary files: the
+formula, the simplified formula and the variable whitelist are passed through pipes.
+**************************************************************************************************/
+
+#ifndef CNFMITER_Simplifier_h
+#define CNFMITER_Simplifier_h
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#include "Dimacs.h"
+#include "DimacsWriter.h"
+#include "SolverTypes.h"
+
+namespace CNFMITER
+{
+
+// Arguments that are added to a simplifier command without placeholders, as for Coprocessor.
+static const char *default_simplifier_arguments = " {input} -whiteList={whitelist} -dimacs={output} -no-dense";
+
+// Replace each occurrence of pattern in text by replacement.
+static void replace_all(std::string &text, const std::string &pattern, const std::string &replacement)
+{
+    for (size_t p = text.find(pattern); p != std::string::npos; p = text.find(pattern, p + replacement.size()))
+        text.replace(p, pattern.size(), replacement);
+}
+
+// Create a pipe, whose ends are closed in child processes, unless they are inherited explicitly.
+// The flag is set atomically, so that a fork of a concurrent job cannot inherit the pipe.
+static bool cloexec_pipe(int fds[2]) { return pipe2(fds, O_CLOEXEC) == 0; }
+
+// Run command via /bin/sh, where {input}, {output} and {whitelist} are replaced by pipes: the
+// simplifier reads the formula f from {input}, and the whitelist "1..<whitelist_vars>" from
+// {whitelist}, and writes the simplified formula to {output}, which is parsed into simplified.
+// A command without any of these placeholders gets the Coprocessor arguments from above. The
+// output of the simplifier on stdout is dropped, its output on stderr is stored in log. Returns
+// the exit code of the simplifier, or -1, if it could not be run. As a simplifier might stop
+// reading early, the caller has to ignore SIGPIPE.
+static int run_simplifier(std::string command, const Formula &f, int whitelist_vars, Formula &simplified, std::string &log)
+{
+    if (command.find("{input}") == std::string::npos && command.find("{output}") == std::string::npos &&
+        command.find("{whitelist}") == std::string::npos)
+        command += default_simplifier_arguments;
+
+    int in[2], out[2], white[2], err[2];
+    if (!cloexec_pipe(in) || !cloexec_pipe(out) || !cloexec_pipe(white) || !cloexec_pipe(err)) return -1;
+    replace_all(command, "{input}", "/dev/fd/" + std::to_string(in[0]));
+    replace_all(command, "{output}", "/dev/fd/" + std::to_string(out[1]));
+    replace_all(command, "{whitelist}", "/dev/fd/" + std::to_string(white[0]));
+
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) { // child: only async-signal-safe calls from here on
+        fcntl(in[0], F_SETFD, 0);
+        fcntl(out[1], F_SETFD, 0);
+        fcntl(white[0], F_SETFD, 0);
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) dup2(null, 1);
+        dup2(err[1], 2);
+        execl("/bin/sh", "sh", "-c", command.c_str(), (char *)NULL);
+        _exit(127);
+    }
+    close(in[0]);
+    close(out[1]);
+    close(white[0]);
+    close(err[1]);
+
+    // the whitelist fits into the pipe buffer, hence it does not block, and is not read, if the
+    // simplifier exited already
+    std::string whitelist = "1.." + std::to_string(whitelist_vars) + "\n";
+    try_write_all(white[1], whitelist.data(), whitelist.size());
+    close(white[1]);
+
+    std::thread writer([&]() {
+        {
+            DimacsWriter w(in[1]);
+            w.ignoreErrors();
+            w.header(f.nVars(), f.nClauses());
+            for (const auto &c : f.clauses) w.clause(c);
+        }
+        close(in[1]);
+    });
+    std::thread reader([&]() {
+        char buffer[4096];
+        for (ssize_t n; (n = read(err[0], buffer, sizeof(buffer))) != 0;) {
+            if (n > 0)
+                log.append(buffer, n);
+            else if (errno != EINTR)
+                break;
+        }
+        close(err[0]);
+    });
+
+    simplified = Formula();
+    bool parsed = parse_DIMACS(("/dev/fd/" + std::to_string(out[0])).c_str(), simplified);
+    close(out[0]);
+    writer.join();
+    reader.join();
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (!parsed || !WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status);
+}
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
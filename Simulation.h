@@ -0,0 +1,194 @@
+/************************************************************************************[Simulation.h]
+Search for assignments that satisfy one formula, but not another one: an evaluator that checks 64
+assignments per machine word, and a WalkSAT local search that finds models of a formula.
+**************************************************************************************************/
+
+#ifndef CNFMITER_Simulation_h
+#define CNFMITER_Simulation_h
+
+#include <vector>
+
+#include "SolverTypes.h"
+
+namespace CNFMITER
+{
+
+// Small and fast pseudo random number generator (xorshift64*), e.g. one per thread.
+class Random
+{
+    uint64_t state;
+
+    public:
+    explicit Random(uint64_t seed) : state(seed ? seed : 0x9e3779b97f4a7c15ULL) {}
+
+    uint64_t next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+
+    // uniform number in [0, n)
+    uint32_t below(uint32_t n) { return (uint32_t)(((next() >> 32) * n) >> 32); }
+    double real() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+//=================================================================================================
+// Bit-parallel evaluation: bit k of values[v] is the value of variable v in assignment k.
+
+static inline uint64_t literal_word(const std::vector<uint64_t> &values, Lit l)
+{
+    return sign(l) ? ~values[var(l)] : values[var(l)];
+}
+
+// Bit k of the result is set, if assignment k is in mask, and satisfies all clauses. Stops early,
+// once no assignment is left.
+static uint64_t satisfied_assignments(const ClauseArena &clauses, const std::vector<uint64_t> &values, uint64_t mask = ~0ULL)
+{
+    for (size_t i = 0; i < clauses.size() && mask != 0; ++i) {
+        uint64_t satisfied = 0;
+        for (Lit l : clauses[i]) satisfied |= literal_word(values, l);
+        mask &= satisfied;
+    }
+    return mask;
+}
+
+// Index of the first clause that is falsified by assignment k, or -1.
+static int64_t first_falsified_clause(const ClauseArena &clauses, const std::vector<uint64_t> &values, int k)
+{
+    for (size_t i = 0; i < clauses.size(); ++i) {
+        uint64_t satisfied = 0;
+        for (Lit l : clauses[i]) satisfied |= literal_word(values, l);
+        if (!((satisfied >> k) & 1)) return (int64_t)i;
+    }
+    return -1;
+}
+
+//=================================================================================================
+// WalkSAT:
+//
+// Picks a random falsified clause, and flips a variable of it that does not falsify other clauses,
+// or with some probability a random one, otherwise the one that falsifies the fewest clauses.
+
+class WalkSAT
+{
+    ClauseArena clauses;
+    std::vector<uint64_t> occ_start; // clauses with literal l: occ[occ_start[l] .. occ_start[l + 1])
+    std::vector<uint32_t> occ;
+    std::vector<uint32_t> true_count; // number of true literals per clause
+    std::vector<uint32_t> unsat, unsat_pos;
+    std::vector<char> assignment;
+    Random rng;
+    double noise;
+    bool has_empty;
+
+    Lit trueLit(Var v) const { return mkLit(v, !assignment[v]); }
+
+    void makeUnsat(uint32_t c)
+    {
+        unsat_pos[c] = unsat.size();
+        unsat.push_back(c);
+    }
+
+    void makeSat(uint32_t c)
+    {
+        uint32_t last = unsat.back();
+        unsat[unsat_pos[c]] = last;
+        unsat_pos[last] = unsat_pos[c];
+        unsat.pop_back();
+    }
+
+    // number of clauses that become false, when v is flipped
+    uint32_t breakCount(Var v) const
+    {
+        Lit l = trueLit(v);
+        uint32_t count = 0;
+        for (uint64_t i = occ_start[toInt(l)]; i < occ_start[toInt(l) + 1]; ++i) count += true_count[occ[i]] == 1;
+        return count;
+    }
+
+    public:
+    uint64_t flips;
+
+    WalkSAT(int vars, uint64_t seed, double noise_ = 0.567)
+      : assignment(vars, 0), rng(seed), noise(noise_), has_empty(false), flips(0)
+    {
+    }
+
+    void addClauses(const ClauseArena &c)
+    {
+        for (const auto &clause : c) {
+            has_empty = has_empty || clause.empty();
+            clauses.push_back(clause);
+        }
+    }
+
+    // Build the occurrence lists, and start from a random assignment.
+    void init()
+    {
+        int vars = assignment.size();
+        occ_start.assign(2 * vars + 1, 0);
+        for (const auto &c : clauses)
+            for (Lit l : c) occ_start[toInt(l) + 1]++;
+        for (size_t i = 1; i < occ_start.size(); ++i) occ_start[i] += occ_start[i - 1];
+        occ.resize(occ_start.back());
+        std::vector<uint64_t> pos(occ_start.begin(), occ_start.end() - 1);
+        for (size_t i = 0; i < clauses.size(); ++i)
+            for (Lit l : clauses[i]) occ[pos[toInt(l)]++] = (uint32_t)i;
+
+        for (Var v = 0; v < vars; ++v) assignment[v] = rng.next() & 1;
+        true_count.assign(clauses.size(), 0);
+        unsat_pos.assign(clauses.size(), 0);
+        unsat.clear();
+        for (size_t i = 0; i < clauses.size(); ++i) {
+            for (Lit l : clauses[i]) true_count[i] += assignment[var(l)] != sign(l);
+            if (true_count[i] == 0) makeUnsat(i);
+        }
+    }
+
+    bool value(Var v) const { return assignment[v]; }
+
+    void flip(Var v)
+    {
+        Lit falsified = trueLit(v), satisfied = ~falsified;
+        assignment[v] = !assignment[v];
+        flips++;
+        for (uint64_t i = occ_start[toInt(satisfied)]; i < occ_start[toInt(satisfied) + 1]; ++i)
+            if (true_count[occ[i]]++ == 0) makeSat(occ[i]);
+        for (uint64_t i = occ_start[toInt(falsified)]; i < occ_start[toInt(falsified) + 1]; ++i)
+            if (--true_count[occ[i]] == 0) makeUnsat(occ[i]);
+    }
+
+    // flip n random variables, to move away from the current model
+    void perturb(int n)
+    {
+        for (int i = 0; i < n && !assignment.empty(); ++i) flip(rng.below(assignment.size()));
+    }
+
+    // Flip variables until all clauses are satisfied, or until stop() returns true, which is
+    // checked every 1024 flips. Returns true, if the current assignment is a model.
+    template <class Stop> bool search(Stop stop)
+    {
+        if (has_empty) return false;
+        while (!unsat.empty()) {
+            if ((flips & 1023) == 0 && stop()) return false;
+
+            ConstClause c = clauses[unsat[rng.below(unsat.size())]];
+            Var best = var(c[0]);
+            uint32_t best_break = ~0U;
+            for (Lit l : c) {
+                uint32_t b = breakCount(var(l));
+                if (b < best_break) best = var(l), best_break = b;
+            }
+            if (best_break > 0 && rng.real() < noise) best = var(c[rng.below(c.size())]);
+            flip(best);
+        }
+        return true;
+    }
+};
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
@@ -0,0 +1,508 @@
+/****************************************************************************************[Solver.h]
+A small CDCL solver, following the structure of MiniSat: two watched literals, first UIP learning
+with clause minimization, VSIDS, phase saving, Luby restarts and reduction of learnt clauses by
+their LBD. Learnt clauses are kept between calls of solve, so that many queries under different
+assumptions can be answered by the same solver. Solvers can be copied, e.g. one per thread.
+**************************************************************************************************/
+
+#ifndef CNFMITER_Solver_h
+#define CNFMITER_Solver_h
+
+#include <algorithm>
+#include <vector>
+
+#include "SolverTypes.h"
+
+namespace CNFMITER
+{
+
+//=================================================================================================
+// Solver:
+
+class Solver
+{
+    typedef uint32_t CRef; // index of an original clause, or of a learnt clause with learnt_bit
+    enum : CRef { CRef_Undef = 0xffffffff, learnt_bit = 0x80000000 };
+
+    struct Watcher {
+        CRef cref;
+        Lit blocker; // some other literal of the clause, if it is true, the clause is satisfied
+    };
+
+    bool ok; // false, if the clauses are unsatisfiable without assumptions
+    ClauseArena originals, learnts;
+    std::vector<unsigned> lbds; // LBD of each learnt clause
+    size_t max_learnts;
+
+    std::vector<std::vector<Watcher> > watches; // watches[p]: clauses that watch ~p
+    std::vector<lbool> assigns;
+    std::vector<int> levels;
+    std::vector<CRef> reasons;
+    std::vector<Lit> trail;
+    std::vector<int> trail_lim;
+    size_t qhead;
+
+    std::vector<double> activity;
+    double var_inc;
+    std::vector<Var> heap; // unassigned variables (and maybe others), by decreasing activity
+    std::vector<int> heap_index;
+    std::vector<char> polarity, seen;
+
+    std::vector<Lit> assumptions, learnt_clause, analyze_toclear;
+
+    public:
+    uint64_t conflicts, decisions, propagations;
+    std::vector<lbool> model; // satisfying assignment, after solve returned l_True
+
+    Solver()
+      : ok(true), max_learnts(10000), qhead(0), var_inc(1), conflicts(0), decisions(0), propagations(0)
+    {
+    }
+
+    int nVars() const { return (int)assigns.size(); }
+    size_t nClauses() const { return originals.size(); }
+    size_t nLearnts() const { return learnts.size(); }
+    bool okay() const { return ok; }
+
+    Var newVar()
+    {
+        Var v = nVars();
+        watches.resize(2 * (v + 1));
+        assigns.push_back(l_Undef);
+        levels.push_back(0);
+        reasons.push_back(CRef_Undef);
+        activity.push_back(0);
+        heap_index.push_back(-1);
+        polarity.push_back(1);
+        seen.push_back(0);
+        heapInsert(v);
+        return v;
+    }
+
+    // Add a clause, variables are created as necessary. Returns false, if the clauses are
+    // unsatisfiable now. Must not be called during solve.
+    bool addClause(ConstClause clause)
+    {
+        assert(decisionLevel() == 0);
+        if (!ok) return false;
+        std::vector<Lit> c(clause.begin(), clause.end());
+        std::sort(c.begin(), c.end());
+        for (Lit l : c)
+            while (var(l) >= nVars()) newVar();
+
+        size_t j = 0;
+        for (size_t i = 0; i < c.size(); ++i) {
+            if (value(c[i]) == l_True || (i > 0 && c[i] == ~c[i - 1])) return true; // satisfied or tautology
+            if (value(c[i]) == l_False || (j > 0 && c[i] == c[j - 1])) continue;
+            c[j++] = c[i];
+        }
+        c.resize(j);
+
+        if (c.empty()) return ok = false;
+        if (c.size() == 1) {
+            uncheckedEnqueue(c[0], CRef_Undef);
+            return ok = propagate() == CRef_Undef;
+        }
+        originals.push_back(c);
+        attachClause((CRef)originals.size() - 1);
+        return true;
+    }
+
+    // Search for a model that satisfies all assumptions. Returns l_False, if there is none, either
+    // because the clauses are unsatisfiable, or because of the assumptions.
+    lbool solve(const std::vector<Lit> &assumps)
+    {
+        model.clear();
+        if (!ok) return l_False;
+        assumptions = assumps;
+        for (Lit l : assumptions)
+            while (var(l) >= nVars()) newVar();
+
+        lbool status = l_Undef;
+        for (int restarts = 0; status == l_Undef; ++restarts) {
+            status = search((int)(luby(2, restarts) * 100));
+            if (status == l_Undef && learnts.size() >= max_learnts + trail.size()) reduceDB();
+        }
+
+        if (status == l_True) model = assigns;
+        cancelUntil(0);
+        return status;
+    }
+
+    lbool value(Var x) const { return assigns[x]; }
+    lbool value(Lit p) const { return assigns[var(p)] ^ sign(p); }
+
+    // Failed literal probing: propagate p on its own decision level, and store the literals that
+    // are implied by p, including p, in implied. Returns false, if p is false, and in case of a
+    // conflict, where ~p is added as a unit. Must not be called during solve.
+    bool probe(Lit p, std::vector<Lit> &implied)
+    {
+        assert(decisionLevel() == 0);
+        implied.clear();
+        while (var(p) >= nVars()) newVar();
+        if (!ok || value(p) == l_False) return false;
+        if (value(p) == l_True) return true;
+
+        trail_lim.push_back(trail.size());
+        uncheckedEnqueue(p, CRef_Undef);
+        bool conflict = propagate() != CRef_Undef;
+        if (!conflict) implied.assign(trail.begin() + trail_lim[0], trail.end());
+        cancelUntil(0);
+        if (!conflict) return true;
+
+        uncheckedEnqueue(~p, CRef_Undef);
+        ok = propagate() == CRef_Undef;
+        return false;
+    }
+
+    private:
+    int decisionLevel() const { return (int)trail_lim.size(); }
+
+    Clause clause(CRef cr) { return cr & learnt_bit ? learnts[cr & ~learnt_bit] : originals[cr]; }
+
+    void attachClause(CRef cr)
+    {
+        Clause c = clause(cr);
+        Watcher w0 = {cr, c[1]}, w1 = {cr, c[0]};
+        watches[toInt(~c[0])].push_back(w0);
+        watches[toInt(~c[1])].push_back(w1);
+    }
+
+    void uncheckedEnqueue(Lit p, CRef from)
+    {
+        assigns[var(p)] = lbool(!sign(p));
+        levels[var(p)] = decisionLevel();
+        reasons[var(p)] = from;
+        trail.push_back(p);
+    }
+
+    void cancelUntil(int level)
+    {
+        if (decisionLevel() <= level) return;
+        for (size_t c = trail.size(); c-- > (size_t)trail_lim[level];) {
+            Var x = var(trail[c]);
+            assigns[x] = l_Undef;
+            polarity[x] = sign(trail[c]);
+            heapInsert(x);
+        }
+        qhead = trail_lim[level];
+        trail.resize(trail_lim[level]);
+        trail_lim.resize(level);
+    }
+
+    // Propagate all enqueued facts. Returns the conflicting clause, or CRef_Undef.
+    CRef propagate()
+    {
+        CRef confl = CRef_Undef;
+        while (qhead < trail.size()) {
+            Lit p = trail[qhead++];
+            Lit false_lit = ~p;
+            std::vector<Watcher> &ws = watches[toInt(p)];
+            propagations++;
+
+            size_t i = 0, j = 0, n = ws.size();
+            while (i < n) {
+                Lit blocker = ws[i].blocker;
+                if (value(blocker) == l_True) {
+                    ws[j++] = ws[i++];
+                    continue;
+                }
+
+                // make sure the false literal is c[1]
+                CRef cr = ws[i++].cref;
+                Clause c = clause(cr);
+                if (c[0] == false_lit) std::swap(c[0], c[1]);
+
+                Lit first = c[0];
+                Watcher w = {cr, first};
+                if (first != blocker && value(first) == l_True) {
+                    ws[j++] = w;
+                    continue;
+                }
+
+                // look for a new literal to watch
+                bool moved = false;
+                for (size_t k = 2; k < c.size(); ++k) {
+                    if (value(c[k]) != l_False) {
+                        c[1] = c[k];
+                        c[k] = false_lit;
+                        watches[toInt(~c[1])].push_back(w);
+                        moved = true;
+                        break;
+                    }
+                }
+                if (moved) continue;
+
+                // clause is unit or conflicting
+                ws[j++] = w;
+                if (value(first) == l_False) {
+                    confl = cr;
+                    qhead = trail.size();
+                    while (i < n) ws[j++] = ws[i++];
+                } else
+                    uncheckedEnqueue(first, cr);
+            }
+            ws.resize(j);
+        }
+        return confl;
+    }
+
+    // First UIP conflict analysis, with removal of literals that are implied by the other literals
+    // of the learnt clause via their reason. The asserting literal ends up first, a literal of the
+    // backtrack level second.
+    void analyze(CRef confl, std::vector<Lit> &out_learnt, int &out_btlevel, unsigned &out_lbd)
+    {
+        int pathC = 0;
+        Lit p = lit_Undef;
+        out_learnt.clear();
+        out_learnt.push_back(lit_Undef);
+        size_t index = trail.size();
+
+        do {
+            Clause c = clause(confl);
+            for (size_t k = p == lit_Undef ? 0 : 1; k < c.size(); ++k) {
+                Var x = var(c[k]);
+                if (seen[x] || levels[x] == 0) continue;
+                varBumpActivity(x);
+                seen[x] = 1;
+                if (levels[x] >= decisionLevel())
+                    pathC++;
+                else
+                    out_learnt.push_back(c[k]);
+            }
+
+            while (!seen[var(trail[--index])]) {
+            }
+            p = trail[index];
+            confl = reasons[var(p)];
+            seen[var(p)] = 0;
+            pathC--;
+        } while (pathC > 0);
+        out_learnt[0] = ~p;
+
+        analyze_toclear = out_learnt;
+        size_t j = 1;
+        for (size_t i = 1; i < out_learnt.size(); ++i) {
+            CRef r = reasons[var(out_learnt[i])];
+            bool keep = r == CRef_Undef;
+            if (!keep) {
+                Clause c = clause(r);
+                for (size_t k = 1; k < c.size() && !keep; ++k) keep = !seen[var(c[k])] && levels[var(c[k])] > 0;
+            }
+            if (keep) out_learnt[j++] = out_learnt[i];
+        }
+        out_learnt.resize(j);
+
+        out_btlevel = 0;
+        if (out_learnt.size() > 1) {
+            size_t max_i = 1;
+            for (size_t i = 2; i < out_learnt.size(); ++i)
+                if (levels[var(out_learnt[i])] > levels[var(out_learnt[max_i])]) max_i = i;
+            std::swap(out_learnt[1], out_learnt[max_i]);
+            out_btlevel = levels[var(out_learnt[1])];
+        }
+
+        for (Lit l : analyze_toclear) seen[var(l)] = 0;
+
+        // LBD: number of different decision levels, use seen on levels temporarily
+        out_lbd = 0;
+        for (Lit l : out_learnt) {
+            int level = levels[var(l)];
+            if (level < (int)seen.size() && !seen[level]) seen[level] = 1, out_lbd++;
+        }
+        for (Lit l : out_learnt) {
+            int level = levels[var(l)];
+            if (level < (int)seen.size()) seen[level] = 0;
+        }
+    }
+
+    lbool search(int nof_conflicts)
+    {
+        int conflictC = 0;
+        for (;;) {
+            CRef confl = propagate();
+            if (confl != CRef_Undef) {
+                conflicts++;
+                conflictC++;
+                if (decisionLevel() == 0) {
+                    ok = false;
+                    return l_False;
+                }
+
+                int backtrack_level;
+                unsigned lbd;
+                analyze(confl, learnt_clause, backtrack_level, lbd);
+                cancelUntil(backtrack_level);
+                if (learnt_clause.size() == 1) {
+                    uncheckedEnqueue(learnt_clause[0], CRef_Undef);
+                } else {
+                    learnts.push_back(learnt_clause);
+                    lbds.push_back(lbd);
+                    CRef cr = (CRef)(learnts.size() - 1) | learnt_bit;
+                    attachClause(cr);
+                    uncheckedEnqueue(learnt_clause[0], cr);
+                }
+                var_inc *= 1 / 0.95;
+                continue;
+            }
+
+            if (nof_conflicts >= 0 && conflictC >= nof_conflicts) {
+                cancelUntil(0);
+                return l_Undef;
+            }
+
+            Lit next = lit_Undef;
+            while (decisionLevel() < (int)assumptions.size()) {
+                Lit p = assumptions[decisionLevel()];
+                if (value(p) == l_True) {
+                    trail_lim.push_back(trail.size()); // dummy decision level
+                } else if (value(p) == l_False) {
+                    return l_False;
+                } else {
+                    next = p;
+                    break;
+                }
+            }
+
+            if (next == lit_Undef) {
+                next = pickBranchLit();
+                if (next == lit_Undef) return l_True; // all variables are assigned
+                decisions++;
+            }
+            trail_lim.push_back(trail.size());
+            uncheckedEnqueue(next, CRef_Undef);
+        }
+    }
+
+    // Remove the worse half of the learnt clauses, except for clauses with an LBD of at most 2.
+    // Runs at level 0, where no reason clause is needed anymore.
+    void reduceDB()
+    {
+        assert(decisionLevel() == 0);
+        for (Lit p : trail) reasons[var(p)] = CRef_Undef;
+
+        std::vector<CRef> order(learnts.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = (CRef)i;
+        std::stable_sort(order.begin(), order.end(), [&](CRef a, CRef b) { return lbds[a] < lbds[b]; });
+
+        std::vector<char> keep(learnts.size(), 0);
+        for (size_t i = 0; i < order.size(); ++i) keep[order[i]] = i < order.size() / 2 || lbds[order[i]] <= 2;
+
+        // move kept clauses to the front, and update the watches
+        std::vector<CRef> moved(learnts.size(), CRef_Undef);
+        ClauseArena kept;
+        std::vector<unsigned> kept_lbds;
+        for (size_t i = 0; i < learnts.size(); ++i) {
+            if (!keep[i]) continue;
+            moved[i] = (CRef)kept.size() | learnt_bit;
+            kept.push_back(learnts[i]);
+            kept_lbds.push_back(lbds[i]);
+        }
+        for (auto &ws : watches) {
+            size_t j = 0;
+            for (size_t i = 0; i < ws.size(); ++i) {
+                if (ws[i].cref & learnt_bit) {
+                    CRef to = moved[ws[i].cref & ~learnt_bit];
+                    if (to == CRef_Undef) continue;
+                    ws[i].cref = to;
+                }
+                ws[j++] = ws[i];
+            }
+            ws.resize(j);
+        }
+        learnts.swap(kept);
+        lbds.swap(kept_lbds);
+        max_learnts += max_learnts / 10;
+    }
+
+    Lit pickBranchLit()
+    {
+        while (!heap.empty()) {
+            Var v = heapRemoveMax();
+            if (value(v) == l_Undef) return mkLit(v, polarity[v]);
+        }
+        return lit_Undef;
+    }
+
+    void varBumpActivity(Var v)
+    {
+        if ((activity[v] += var_inc) > 1e100) {
+            for (double &a : activity) a *= 1e-100;
+            var_inc *= 1e-100;
+        }
+        if (heap_index[v] >= 0) percolateUp(heap_index[v]);
+    }
+
+    // Finite subsequence of the Luby-sequence: 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ...
+    static double luby(double y, int x)
+    {
+        int size, seq;
+        for (size = 1, seq = 0; size < x + 1; seq++, size = 2 * size + 1) {
+        }
+        while (size - 1 != x) {
+            size = (size - 1) >> 1;
+            seq--;
+            x = x % size;
+        }
+        double result = 1;
+        while (seq-- > 0) result *= y;
+        return result;
+    }
+
+    //=============================================================================================
+    // Binary heap of variables, by decreasing activity:
+
+    void heapInsert(Var v)
+    {
+        if (heap_index[v] >= 0) return;
+        heap_index[v] = (int)heap.size();
+        heap.push_back(v);
+        percolateUp(heap_index[v]);
+    }
+
+    Var heapRemoveMax()
+    {
+        Var v = heap[0];
+        heap[0] = heap.back();
+        heap_index[heap[0]] = 0;
+        heap_index[v] = -1;
+        heap.pop_back();
+        if (heap.size() > 1) percolateDown(0);
+        return v;
+    }
+
+    void percolateUp(int i)
+    {
+        Var v = heap[i];
+        while (i > 0) {
+            int parent = (i - 1) >> 1;
+            if (activity[heap[parent]] >= activity[v]) break;
+            heap[i] = heap[parent];
+            heap_index[heap[i]] = i;
+            i = parent;
+        }
+        heap[i] = v;
+        heap_index[v] = i;
+    }
+
+    void percolateDown(int i)
+    {
+        Var v = heap[i];
+        for (;;) {
+            size_t child = 2 * (size_t)i + 1;
+            if (child >= heap.size()) break;
+            if (child + 1 < heap.size() && activity[heap[child + 1]] > activity[heap[child]]) child++;
+            if (activity[heap[child]] <= activity[v]) break;
+            heap[i] = heap[child];
+            heap_index[heap[i]] = i;
+            i = (int)child;
+        }
+        heap[i] = v;
+        heap_index[v] = i;
+    }
+};
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
@@ -103,7 +103,7 @@ const Lit lit_Error = { -1 }; // }
 
 inline std::ostream &operator<<(std::ostream &out, const Lit &val)
 {
-    out << (sign(val) ? -var(val) - 1 : var(val) + 1) << std::flush;
+    out << (sign(val) ? -var(val) - 1 : var(val) + 1);
     return out;
 }
 
@@ -163,12 +163,156 @@ template <class T> inline std::ostream &operator<<(std::ostream &out, const std:
     return out;
 }
 
+//=================================================================================================
+// Clauses:
+//
+// All clauses of a formula are stored in a single literal array, plus the offset of each clause in
+// this array. Clauses are handed out as light-weight views into this array.
+
+template <class L> class ClauseSpan
+{
+    L *lits;
+    size_t sz;
+
+    public:
+    ClauseSpan(L *l, size_t s) : lits(l), sz(s) {}
+    ClauseSpan(const std::vector<Lit> &v) : lits(v.data()), sz(v.size()) {}          // only for const views
+    template <class M> ClauseSpan(const ClauseSpan<M> &c) : lits(c.data()), sz(c.size()) {} // to const views
+
+    size_t size() const { return sz; }
+    bool empty() const { return sz == 0; }
+    L *data() const { return lits; }
+    L *begin() const { return lits; }
+    L *end() const { return lits + sz; }
+    L &operator[](size_t i) const { return lits[i]; }
+};
+
+typedef ClauseSpan<Lit> Clause;
+typedef ClauseSpan<const Lit> ConstClause;
+
+template <class L> inline std::ostream &operator<<(std::ostream &out, const ClauseSpan<L> &cls)
+{
+    for (size_t i = 0; i < cls.size(); ++i) {
+        out << cls[i] << " ";
+    }
+
+    return out;
+}
+
+class ClauseArena
+{
+    std::vector<Lit> lits;
+    std::vector<uint64_t> starts; // clause i is lits[starts[i] .. starts[i+1])
+
+    public:
+    template <class A, class C> class Iterator
+    {
+        A *arena;
+        size_t i;
+
+        public:
+        Iterator(A *a, size_t p) : arena(a), i(p) {}
+        C operator*() const { return (*arena)[i]; }
+        Iterator &operator++()
+        {
+            ++i;
+            return *this;
+        }
+        bool operator!=(const Iterator &o) const { return i != o.i; }
+        bool operator==(const Iterator &o) const { return i == o.i; }
+    };
+    typedef Iterator<ClauseArena, Clause> iterator;
+    typedef Iterator<const ClauseArena, ConstClause> const_iterator;
+
+    ClauseArena() : starts(1, 0) {}
+
+    size_t size() const { return starts.size() - 1; }
+    bool empty() const { return size() == 0; }
+    size_t literals() const { return lits.size(); }
+
+    Clause operator[](size_t i) { return Clause(lits.data() + starts[i], starts[i + 1] - starts[i]); }
+    ConstClause operator[](size_t i) const { return ConstClause(lits.data() + starts[i], starts[i + 1] - starts[i]); }
+    Clause back() { return (*this)[size() - 1]; }
+    ConstClause back() const { return (*this)[size() - 1]; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    void reserve(size_t clauses, size_t literals = 0)
+    {
+        starts.reserve(clauses + 1);
+        if (literals > 0) lits.reserve(literals);
+    }
+
+    void push_back(ConstClause c)
+    {
+        const Lit *from = c.data();
+        if (from >= lits.data() && from < lits.data() + lits.size()) { // copy of a clause of this arena
+            size_t offset = from - lits.data();
+            lits.reserve(lits.size() + c.size());
+            from = lits.data() + offset;
+        }
+        lits.insert(lits.end(), from, from + c.size());
+        starts.push_back(lits.size());
+    }
+
+    // Build a clause literal by literal: add the literals, then close the clause.
+    void pushLit(Lit l) { lits.push_back(l); }
+    void closeClause() { starts.push_back(lits.size()); }
+
+    void pop_back()
+    {
+        starts.pop_back();
+        lits.resize(starts.back());
+    }
+
+    void clear()
+    {
+        lits.clear();
+        starts.resize(1);
+    }
+
+    // Keep only the clauses with the given indices, in the given order.
+    void select(const std::vector<size_t> &order) { select(*this, order); }
+
+    // Replace the clauses by copies of the clauses of from with the given indices, in the given order.
+    void select(const ClauseArena &from, const std::vector<size_t> &order)
+    {
+        ClauseArena result;
+        size_t literals = 0;
+        for (size_t i : order) literals += from.starts[i + 1] - from.starts[i];
+        result.reserve(order.size(), literals);
+        for (size_t i : order) result.push_back(from[i]);
+        swap(result);
+    }
+
+    void swap(ClauseArena &other)
+    {
+        lits.swap(other.lits);
+        starts.swap(other.starts);
+    }
+
+    // Raw storage, e.g. for binary files: the literals of all clauses, and size() + 1 clause starts.
+    const Lit *literalData() const { return lits.data(); }
+    const uint64_t *startData() const { return starts.data(); }
+
+    // Replace all clauses by copies of the given raw storage, with starts[0] == 0.
+    void assign(const Lit *literals, const uint64_t *starts_, size_t clauses)
+    {
+        starts.assign(starts_, starts_ + clauses + 1);
+        lits.assign(literals, literals + starts.back());
+    }
+};
+
 class Formula
 {
     Var vars = 0;
 
     public:
-    std::vector<std::vector<Lit>> clauses;
+    ClauseArena clauses;
+    std::vector<Var> projection; // variables of projection lines ("c ind", "c p show"), in file order
 
     int nVars() const { return vars; } // The current number of variables.
     Var newVar()
@@ -177,8 +321,35 @@ class Formula
         vars++;
         return v;
     }; // Add a new variable
+    void ensureVars(int n)
+    {
+        if (vars < n) vars = n;
+    } // Add new variables, until there are at least n
+
+    // Presize for the given number of clauses (and literals), e.g. from a DIMACS header.
+    void reserve(size_t clauses_, size_t literals = 0) { clauses.reserve(clauses_, literals); }
+
+    size_t nClauses() const { return clauses.size(); }
+    void addClause_(ConstClause clause) { clauses.push_back(clause); }
+};
+
+// Same interface as Formula, but only counts variables and clauses. Allows to compute the size of
+// an encoding, e.g. for a DIMACS header, without storing it.
+class CountingFormula
+{
+    Var vars = 0;
+    uint64_t clauses = 0;
+
+    public:
+    int nVars() const { return vars; }
+    Var newVar() { return vars++; }
+    void ensureVars(int n)
+    {
+        if (vars < n) vars = n;
+    }
 
-    void addClause_(const std::vector<Lit> &clause) { clauses.push_back(clause); }
+    uint64_t nClauses() const { return clauses; }
+    void addClause_(ConstClause) { clauses++; }
 };
 
 //=================================================================================================
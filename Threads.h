@@ -0,0 +1,46 @@
+/***************************************************************************************[Threads.h]
+Small helpers to distribute independent work items over a number of threads.
+**************************************************************************************************/
+
+#ifndef CNFMITER_Threads_h
+#define CNFMITER_Threads_h
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace CNFMITER
+{
+
+// Number of threads to use by default: all available cores.
+static inline int default_threads()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : (int)n;
+}
+
+// Calls f(i) for all 0 <= i < n, on at most 'threads' threads. Items are handed out in order,
+// the calling thread works as well. Returns once all items have been processed.
+template <class F> static void parallel_for(int n, int threads, F f)
+{
+    if (threads > n) threads = n;
+    if (threads <= 1) {
+        for (int i = 0; i < n; ++i) f(i);
+        return;
+    }
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < n; i = next++) f(i);
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.push_back(std::thread(worker));
+    worker();
+    for (auto &t : pool) t.join();
+}
+
+//=================================================================================================
+} // namespace CNFMITER
+
+#endif
@@ -15,6 +15,20 @@ check_unsat ()
     fi
 }
 
+check_sat ()
+{
+    local S="$1"
+    local C="$2"
+
+    local STATUS=0
+    "$S" "$C" | grep "s SATISFIABLE" || STATUS=$? &> /dev/null
+
+    if [ "$STATUS" -ne 0 ]; then
+        echo "Did not get exit code 10 when running $S $C, but $STATUS"
+        exit 1
+    fi
+}
+
 SCRIPTDIR=$(cd $(dirname $0) && pwd)
 
 make -C "$SCRIPTDIR"/..
@@ -60,4 +74,214 @@ check_unsat "$solver" "$TMPCNF"
 ../cnfmiter -t 7 amk-7-2-bdd.cnf amk-7-2-card.cnf > "$TMPCNF" 2> /dev/null
 check_unsat "$solver" "$TMPCNF"
 ../cnfmiter -t 7 amk-7-2-card.cnf amk-7-2-bdd.cnf > "$TMPCNF" 2> /dev/null
-check_unsat "$solver" "$TMPCNF"
\ No newline at end of file
+check_unsat "$solver" "$TMPCNF"
+
+# the one-sided definitions of the counters keep at most 2 and at most 3 apart
+../cnfmiter -t 7 amk-7-2-card.cnf amk-7-3-seq.cnf > "$TMPCNF" 2> /dev/null
+check_sat "$solver" "$TMPCNF"
+../cnfmiter -t 7 amk-7-3-seq.cnf amk-7-2-bdd.cnf > "$TMPCNF" 2> /dev/null
+check_sat "$solver" "$TMPCNF"
+
+# the same function from XOR, majority and ITE gates, and with a wrong carry
+../cnfmiter -t 3 adder-3-maj.cnf adder-3-ite.cnf > "$TMPCNF" 2> /dev/null
+check_unsat "$solver" "$TMPCNF"
+../cnfmiter -t 3 adder-3-ite.cnf adder-3-maj.cnf > "$TMPCNF" 2> /dev/null
+check_unsat "$solver" "$TMPCNF"
+../cnfmiter -t 3 adder-3-maj.cnf adder-3-ite-wrong.cnf > "$TMPCNF" 2> /dev/null
+check_sat "$solver" "$TMPCNF"
+
+# pre-check by sampling finds no counterexample, and falls back to the miter
+../cnfmiter --precheck 0.1 -t 4 amo-4-eq.cnf amo-4-naive.cnf > "$TMPCNF" 2> /dev/null
+check_unsat "$solver" "$TMPCNF"
+
+# component miters
+TMPDIR=$(mktemp -d)
+trap '[ -r "$TMPCNF" ] && rm -f "$TMPCNF"; rm -rf "$TMPDIR"' EXIT
+../cnfmiter -C 1 -o "$TMPDIR"/miter.cnf 3.cnf 3.cnf 2> /dev/null
+for part in "$TMPDIR"/miter.*.cnf
+do
+    check_unsat "$solver" "$part"
+done
+
+# two components, written differently in the formulas: 1 xor 2, and the unit 3
+printf 'p cnf 4 4\n1 2 0\n-1 -2 0\n3 4 0\n3 -4 0\n' > "$TMPDIR"/comp1.cnf
+printf 'p cnf 5 4\n1 2 5 0\n1 2 -5 0\n-1 -2 0\n3 0\n' > "$TMPDIR"/comp2.cnf
+../cnfmiter -C 1 -o "$TMPDIR"/equal.cnf "$TMPDIR"/comp1.cnf "$TMPDIR"/comp2.cnf 2> /dev/null
+if [ "$(grep -vc "^c" "$TMPDIR"/equal.manifest)" -ne 2 ]; then
+    echo "Did not get 2 component miters"
+    exit 1
+fi
+check_unsat "$solver" "$TMPDIR"/equal.1.cnf
+check_unsat "$solver" "$TMPDIR"/equal.2.cnf
+# without the unit 3, only the miter of the second component is satisfiable
+printf 'p cnf 4 3\n1 2 0\n-1 -2 0\n3 4 0\n' > "$TMPDIR"/comp3.cnf
+../cnfmiter -C 1 -o "$TMPDIR"/differ.cnf "$TMPDIR"/comp1.cnf "$TMPDIR"/comp3.cnf 2> /dev/null
+check_unsat "$solver" "$TMPDIR"/differ.1.cnf
+check_sat "$solver" "$TMPDIR"/differ.2.cnf
+
+# implication checks, as two files and with a selector
+../cnfmiter -D 2 -o "$TMPDIR"/implies.cnf -t 7 amk-7-2-bdd.cnf amk-7-2-card.cnf 2> /dev/null
+check_unsat "$solver" "$TMPDIR"/implies.12.cnf
+check_unsat "$solver" "$TMPDIR"/implies.21.cnf
+../cnfmiter -D 1 -t 4 amo-4-naive.cnf amo-4-eq.cnf > "$TMPCNF" 2> /dev/null
+check_unsat "$solver" "$TMPCNF"
+
+# partitioned implication checks
+../cnfmiter -P 3 -L -o "$TMPDIR"/part.cnf -t 4 amo-4-eq.cnf amo-4-naive.cnf 2> /dev/null
+for part in "$TMPDIR"/part.*.cnf
+do
+    check_unsat "$solver" "$part"
+done
+
+# built-in equivalence check, 20 for equivalent formulas, 10 otherwise
+check_equivalence ()
+{
+    local EXPECTED="$1"
+    shift
+
+    local STATUS=0
+    ../cnfmiter --check "$@" &> /dev/null || STATUS=$?
+
+    if [ "$STATUS" -ne "$EXPECTED" ]; then
+        echo "Did not get exit code $EXPECTED when checking $*, but $STATUS"
+        exit 1
+    fi
+}
+
+check_equivalence 20 -t 4 amo-4-naive.cnf amo-4-eq.cnf
+check_equivalence 20 -t 7 amk-7-2-card.cnf amk-7-2-bdd.cnf
+check_equivalence 10 -t 7 amk-7-2-card.cnf amk-7-3-seq.cnf
+check_equivalence 20 -t 3 adder-3-ite.cnf adder-3-maj.cnf
+check_equivalence 10 -t 3 adder-3-ite-wrong.cnf adder-3-maj.cnf
+check_equivalence 20 4.cnf 4.cnf
+check_equivalence 10 -r 3 3.cnf 3.cnf
+
+# input variables from a projection line
+(echo "c ind 1 2 3 4 0"; cat amo-4-eq.cnf) > "$TMPDIR"/amo-4-ind.cnf
+check_equivalence 20 -t auto "$TMPDIR"/amo-4-ind.cnf amo-4-naive.cnf
+
+# detected inputs 5 6 7, with gate outputs numbered below them: the carry as a majority gate, as
+# (5 & 6) | (7 & (5 | 6)), and wrong as (5 & 6) | (7 & 5 & 6)
+printf 'p cnf 7 7\n-1 5 6 0\n-1 5 7 0\n-1 6 7 0\n1 -5 -6 0\n1 -5 -7 0\n1 -6 -7 0\n1 0\n' > "$TMPDIR"/carry1.cnf
+printf 'p cnf 7 13\n-1 5 0\n-1 6 0\n1 -5 -6 0\n2 -5 0\n2 -6 0\n-2 5 6 0\n-3 7 0\n-3 2 0\n3 -7 -2 0\n4 -1 0\n4 -3 0\n-4 1 3 0\n4 0\n' > "$TMPDIR"/carry2.cnf
+sed 's/^-3 2 0$/-3 1 0/; s/^3 -7 -2 0$/3 -7 -1 0/' "$TMPDIR"/carry2.cnf > "$TMPDIR"/carry3.cnf
+check_equivalence 20 -t auto "$TMPDIR"/carry1.cnf "$TMPDIR"/carry2.cnf
+check_equivalence 10 -t auto "$TMPDIR"/carry1.cnf "$TMPDIR"/carry3.cnf
+
+# amo-4 has 4 solutions on its input variables, hence not 5 distinct ones
+../atleasttwosolutions -k 5 -t 4 amo-4-naive.cnf > "$TMPCNF" 2> /dev/null
+check_unsat "$solver" "$TMPCNF"
+
+# two solutions, for a formula with a single solution and for amo-4
+printf 'p cnf 3 3\n1 0\n-1 -2 0\n2 3 0\n' > "$TMPDIR"/single.cnf
+for backbone in "" --no-backbone; do
+    ../atleasttwosolutions $backbone "$TMPDIR"/single.cnf > "$TMPCNF" 2> /dev/null
+    check_unsat "$solver" "$TMPCNF"
+    ../atleasttwosolutions $backbone -t 4 amo-4-naive.cnf > "$TMPCNF" 2> /dev/null
+    check_sat "$solver" "$TMPCNF"
+done
+
+# variables 3 and 4 of -t 4 do not occur in the formula, hence they are free in both solutions
+printf 'p cnf 2 2\n1 0\n-2 0\n' > "$TMPDIR"/units.cnf
+../atleasttwosolutions -t 4 "$TMPDIR"/units.cnf > "$TMPCNF" 2> /dev/null
+check_sat "$solver" "$TMPCNF"
+
+# the solutions of amo-4 differ in at most 2 input variables, with each cardinality encoding
+for encoding in totalizer counter sorter; do
+    ../atleasttwosolutions -d 2 --cardinality "$encoding" -t 4 amo-4-naive.cnf > "$TMPCNF" 2> /dev/null
+    check_sat "$solver" "$TMPCNF"
+    ../atleasttwosolutions -d 3 --cardinality "$encoding" -t 4 amo-4-naive.cnf > "$TMPCNF" 2> /dev/null
+    check_unsat "$solver" "$TMPCNF"
+done
+# a distance above the number of compared variables ends with the empty clause
+../atleasttwosolutions -d 5 -t 4 amo-4-naive.cnf > "$TMPCNF" 2> /dev/null
+check_unsat "$solver" "$TMPCNF"
+
+# lowest cost of a MaxSat formula with few soft clauses, by solving the hard clauses together with
+# each subset of the soft clauses
+maxsat_optimum ()
+{
+    local S="$1"
+    local W="$2"
+
+    local VARS=$(awk '$1 != "c" && $1 != "p" {for (i = 2; i < NF; ++i) if ($i > v || -$i > v) v = ($i < 0 ? -$i : $i)} END {print v + 0}' "$W")
+    local SOFT=($(awk '$1 ~ /^[0-9]+$/ {print NR}' "$W"))
+    local BEST=-1
+    for ((mask = 0; mask < (1 << ${#SOFT[@]}); ++mask)); do
+        local COST=0
+        local LINES="h"
+        for ((i = 0; i < ${#SOFT[@]}; ++i)); do
+            if (( mask >> i & 1 )); then
+                LINES="$LINES|${SOFT[$i]}"
+            else
+                COST=$((COST + $(sed -n "${SOFT[$i]}p" "$W" | cut -d' ' -f1)))
+            fi
+        done
+        awk -v lines="$LINES" 'BEGIN {n = split(lines, l, "|"); for (i = 2; i <= n; ++i) keep[l[i]] = 1}
+            $1 == "h" || keep[NR] {$1 = ""; print}' "$W" > "$W".clauses
+        (echo "p cnf $VARS $(wc -l < "$W".clauses)"; cat "$W".clauses) > "$W".cnf
+        if "$S" "$W".cnf | grep "s SATISFIABLE" > /dev/null && [ "$BEST" -lt 0 -o "$COST" -lt "$BEST" ]; then
+            BEST=$COST
+        fi
+    done
+    echo "$BEST"
+}
+
+check_maxsat_optimum ()
+{
+    local EXPECTED="$1"
+    local W="$2"
+
+    local OPTIMUM=$(maxsat_optimum "$solver" "$W")
+    if [ "$OPTIMUM" -ne "$EXPECTED" ]; then
+        echo "Did not get the MaxSat optimum $EXPECTED for $W, but $OPTIMUM"
+        exit 1
+    fi
+}
+
+# variable 3 is fixed, and 1 and 2 are free, hence the lowest MaxSat cost is 1, also without
+# comparing variable 3
+printf 'p cnf 5 5\n5 0\n5 -1 0\n4 3 0\n-3 2 0\n-3 -2 0\n' > "$TMPDIR"/fixed.cnf
+for backbone in "" --no-backbone; do
+    ../atleasttwosolutions -W -t 3 $backbone "$TMPDIR"/fixed.cnf > "$TMPDIR"/fixed.wcnf 2> /dev/null
+    check_maxsat_optimum 1 "$TMPDIR"/fixed.wcnf
+done
+
+# variable 1 is fixed by a failed literal, 2 and 3 are equivalent, and 4 is free: the backbone
+# analysis compares 2 and 4 only, and has to give the same results
+printf 'p cnf 6 6\n1 5 0\n1 -5 0\n-2 3 0\n2 -3 0\n4 6 0\n-4 6 0\n' > "$TMPDIR"/backbone.cnf
+for backbone in "" --no-backbone; do
+    ../atleasttwosolutions -t 4 $backbone "$TMPDIR"/backbone.cnf > "$TMPCNF" 2> /dev/null
+    check_sat "$solver" "$TMPCNF"
+    ../atleasttwosolutions -t 1 $backbone "$TMPDIR"/backbone.cnf > "$TMPCNF" 2> /dev/null
+    check_unsat "$solver" "$TMPCNF"
+    ../atleasttwosolutions -W -t 4 $backbone "$TMPDIR"/backbone.cnf > "$TMPDIR"/backbone.wcnf 2> /dev/null
+    check_maxsat_optimum 1 "$TMPDIR"/backbone.wcnf
+done
+
+# batch mode, the amo formulas are parsed once for both jobs
+cat > "$TMPDIR"/batch.txt << EOB
+# formula1 formula2 with options, one job per line
+-t 4 -o $TMPDIR/batch.1.cnf amo-4-naive.cnf amo-4-eq.cnf
+-t 4 --check -o $TMPDIR/batch.2.txt amo-4-naive.cnf amo-4-eq.cnf
+EOB
+../cnfmiter -j 2 --batch "$TMPDIR"/batch.txt 2> /dev/null
+check_unsat "$solver" "$TMPDIR"/batch.1.cnf
+grep -q "s EQUIVALENT" "$TMPDIR"/batch.2.txt
+
+# binary formula cache, the second call loads both formulas from the cache
+../cnfmiter --cache-dir "$TMPDIR"/cache -o "$TMPDIR"/parsed.cnf 1.cnf 2.cnf 2> /dev/null
+if [ $(ls "$TMPDIR"/cache/*.cnfb 2> /dev/null | wc -l) -ne 2 ]; then
+    echo "Did not write a binary formula per input to $TMPDIR/cache"
+    exit 1
+fi
+../cnfmiter --cache-dir "$TMPDIR"/cache -o "$TMPDIR"/cached.cnf 1.cnf 2.cnf 2> "$TMPDIR"/cached.log
+if [ $(grep -c "from cache" "$TMPDIR"/cached.log) -ne 2 ]; then
+    echo "Did not load both formulas from the cache in $TMPDIR/cache"
+    exit 1
+fi
+cmp "$TMPDIR"/parsed.cnf "$TMPDIR"/cached.cnf || exit 1
+
+# in-process simplification miter, with a simplifier that does not change the formula
+../cnfmiter --simplifier 'cat {input} > {output}' amo-4-eq.cnf > "$TMPCNF" 2> /dev/null
+check_unsat "$solver" "$TMPCNF"
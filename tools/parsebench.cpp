@@ -0,0 +1,115 @@
+#include "Dimacs.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace CNFMITER;
+
+// The character-by-character clause reader, as used before the bulk parser.
+template <class B> static void readClauseScalar(B &in, Formula &S, std::vector<Lit> &lits)
+{
+    int parsed_lit, var;
+    lits.clear();
+    for (;;) {
+        parsed_lit = parseInt(in);
+        if (parsed_lit == 0) break;
+        var = abs(parsed_lit) - 1;
+        while (var >= S.nVars()) S.newVar();
+        lits.push_back((parsed_lit > 0) ? mkLit(var) : ~mkLit(var));
+    }
+}
+
+template <bool bulk> static double run(const std::string &text, Formula &S)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    MappedBuffer in((const unsigned char *)text.data(), text.size());
+    std::vector<Lit> lits;
+    for (;;) {
+        skipWhitespace(in);
+        if (*in == EOF) break;
+        if (bulk)
+            readClause(in, S, lits);
+        else
+            readClauseScalar(in, S, lits);
+        S.addClause_(lits);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Only decode the integers, to measure the tokenizer without building clauses.
+template <bool bulk> static double tokenize(const std::string &text, int64_t &sum)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    MappedBuffer in((const unsigned char *)text.data(), text.size());
+    sum = 0;
+    for (;;) {
+        skipWhitespace(in);
+        if (*in == EOF) break;
+        int v;
+        if (!bulk || !parseIntBulk(in, v)) v = parseInt(in);
+        sum += v;
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint64_t checksum(const Formula &S)
+{
+    uint64_t h = S.clauses.size();
+    for (const auto &c : S.clauses)
+        for (Lit l : c) h = h * 31 + toInt(l);
+    return h;
+}
+
+int main(int argc, char *argv[])
+{
+    int clauses = argc > 1 ? atoi(argv[1]) : 2000000;
+    int vars = argc > 2 ? atoi(argv[2]) : 1000000;
+    int rounds = 3;
+
+    std::cout << "c parsebench: " << clauses << " random clauses over " << vars << " variables" << std::endl;
+
+    srand(1234);
+    std::string text;
+    for (int i = 0; i < clauses; ++i) {
+        int size = 1 + rand() % 6;
+        for (int j = 0; j < size; ++j) {
+            int v = 1 + rand() % vars;
+            text += std::to_string(rand() % 2 ? v : -v);
+            text += ' ';
+        }
+        text += "0\n";
+    }
+    double mb = text.size() / (1024.0 * 1024.0);
+
+    double best[2] = { 1e9, 1e9 }, tokens[2] = { 1e9, 1e9 };
+    uint64_t sums[2] = { 0, 0 };
+    int64_t tsums[2] = { 0, 0 };
+    for (int r = 0; r < rounds; ++r) {
+        double t = tokenize<false>(text, tsums[0]);
+        if (t < tokens[0]) tokens[0] = t;
+        t = tokenize<true>(text, tsums[1]);
+        if (t < tokens[1]) tokens[1] = t;
+    }
+    for (int r = 0; r < rounds; ++r) {
+        Formula scalar, bulk;
+        double t = run<false>(text, scalar);
+        if (t < best[0]) best[0] = t;
+        sums[0] = checksum(scalar);
+        t = run<true>(text, bulk);
+        if (t < best[1]) best[1] = t;
+        sums[1] = checksum(bulk);
+    }
+
+    std::cout << "tokenize scalar: " << mb / tokens[0] << " MB/s" << std::endl;
+    std::cout << "tokenize bulk:   " << mb / tokens[1] << " MB/s" << std::endl;
+    std::cout << "clauses scalar:  " << mb / best[0] << " MB/s" << std::endl;
+    std::cout << "clauses bulk:    " << mb / best[1] << " MB/s" << std::endl;
+    if (sums[0] != sums[1] || tsums[0] != tsums[1]) {
+        std::cout << "ERROR: parsers disagree" << std::endl;
+        return 1;
+    }
+    return 0;
+}
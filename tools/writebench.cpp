@@ -0,0 +1,76 @@
+#include "DimacsWriter.h"
+
+#include <fcntl.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace CNFMITER;
+
+// The stream based printing, as used before the buffered writer.
+static void printStream(FILE *out, const Formula &f)
+{
+    fprintf(out, "p cnf %d %zu\n", f.nVars(), f.clauses.size());
+    for (const auto &c : f.clauses) {
+        std::stringstream s;
+        s << c;
+        fprintf(out, "%s 0\n", s.str().c_str());
+    }
+    fflush(out);
+}
+
+static uint64_t printWriter(int fd, const Formula &f)
+{
+    DimacsWriter out(fd);
+    out.header(f.nVars(), f.clauses.size());
+    for (const auto &c : f.clauses) out.clause(c);
+    out.flush();
+    return out.bytes();
+}
+
+int main(int argc, char *argv[])
+{
+    int clauses = argc > 1 ? atoi(argv[1]) : 2000000;
+    int vars = argc > 2 ? atoi(argv[2]) : 1000000;
+    const char *target = argc > 3 ? argv[3] : "/dev/null";
+
+    std::cout << "c writebench: " << clauses << " random clauses over " << vars << " variables to " << target
+              << std::endl;
+
+    srand(1234);
+    Formula f;
+    f.ensureVars(vars);
+    std::vector<Lit> lits;
+    for (int i = 0; i < clauses; ++i) {
+        lits.clear();
+        int size = 1 + rand() % 6;
+        for (int j = 0; j < size; ++j) lits.push_back(mkLit(rand() % vars, rand() % 2));
+        f.addClause_(lits);
+    }
+
+    int fd = open(target, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "cannot open " << target << std::endl;
+        return 1;
+    }
+
+    FILE *out = fdopen(dup(fd), "w");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    printStream(out, f);
+    double stream_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fclose(out);
+
+    lseek(fd, 0, SEEK_SET);
+    start = std::chrono::steady_clock::now();
+    uint64_t bytes = printWriter(fd, f); // both variants produce the same bytes
+    double writer_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    close(fd);
+
+    double mb = bytes / (1024.0 * 1024.0);
+    std::cout << "stream: " << mb / stream_seconds << " MB/s" << std::endl;
+    std::cout << "writer: " << mb / writer_seconds << " MB/s" << std::endl;
+    return 0;
+}